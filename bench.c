@@ -0,0 +1,897 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "simplex.h"
+#include "voct.h"
+#include "gen.h"
+#include "svo.h"
+
+/* noise throughput benchmark. every function is timed over the same point
+ * sets, once on one thread and once split across all cores, and reported as
+ * samples per second. the best of BENCH_REPS runs is kept. the fractal grids
+ * are checked against their stated tolerance, and the last tables measure
+ * coarse generation's error against refine_step, and time turning
+ * one generated chunk into an octree and that octree into instances
+ */
+
+#define BENCH_REPS 3
+
+/* points are spaced like voxels in a chunk, one noise unit per 32 */
+#define BENCH_SCALE (1.0 / 32.0)
+
+/* chunk benchmarks all generate the chunk at the world origin */
+static int32_t const bench_origin[3] = { 0, 0, 0 };
+
+typedef enum bench_pattern_t {
+	BENCH_PATTERN_LINEAR = 0,
+	BENCH_PATTERN_RANDOM = 1,
+	BENCH_PATTERN_MORTON = 2,
+	BENCH_PATTERN_COUNT,
+} bench_pattern_t;
+
+static char const *const bench_pattern_names[BENCH_PATTERN_COUNT] = {
+	"linear",
+	"random",
+	"morton",
+};
+
+typedef struct bench_points_t {
+	size_t count;
+	uint32_t side;
+	double *x, *y, *z;
+	float *xf, *yf, *zf;
+} bench_points_t;
+
+typedef enum bench_kind_t {
+	BENCH_POINT,
+	BENCH_GRID,
+} bench_kind_t;
+
+typedef struct bench_fn_t {
+	char const *name;
+	bench_kind_t kind;
+
+	/* sums the noise over points [begin, end) */
+	double (*point)(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end);
+
+	/* sums the noise over x planes [begin, end) of the side^3 cube */
+	double (*grid)(struct osn_context const *noise, uint32_t side, uint32_t begin, uint32_t end);
+} bench_fn_t;
+
+static double bench_noise2(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise2(noise, points->x[i], points->z[i]);
+	return sum;
+}
+
+static double bench_noise3(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise3(noise, points->x[i], points->y[i], points->z[i]);
+	return sum;
+}
+
+static double bench_noise4(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise4(noise, points->x[i], points->y[i], points->z[i], points->x[i] + points->z[i]);
+	return sum;
+}
+
+static double bench_noise2f(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise2f(noise, points->xf[i], points->zf[i]);
+	return sum;
+}
+
+static double bench_noise3f(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise3f(noise, points->xf[i], points->yf[i], points->zf[i]);
+	return sum;
+}
+
+static double bench_noise4f(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise4f(noise, points->xf[i], points->yf[i], points->zf[i], points->xf[i] + points->zf[i]);
+	return sum;
+}
+
+static struct osn_fractal const bench_fractal = {
+	.type = OSN_FRACTAL_FBM,
+	.octaves = 4,
+	.lacunarity = 2.0,
+	.gain = 0.5,
+	.early_exit = 1,
+	.threshold = 0.0,
+};
+
+static double bench_fractal3(struct osn_context const *noise, bench_points_t const *points, size_t begin, size_t end) {
+	double sum = 0;
+	for (size_t i = begin; i < end; i++)
+		sum += open_simplex_noise3_fractal(noise, &bench_fractal, points->x[i], points->y[i], points->z[i], NULL);
+	return sum;
+}
+
+static double bench_grid3(struct osn_context const *noise, uint32_t side, uint32_t begin, uint32_t end) {
+	double *out = malloc(sizeof(*out) * side * side);
+	double sum = 0;
+
+	for (uint32_t i = begin; i < end; i++) {
+		open_simplex_noise3_grid(noise, i * BENCH_SCALE, 0, 0, BENCH_SCALE, 1, side, side, out);
+		for (size_t j = 0; j < (size_t) side * side; j++)
+			sum += out[j];
+	}
+
+	free(out);
+	return sum;
+}
+
+static double bench_grid3f(struct osn_context const *noise, uint32_t side, uint32_t begin, uint32_t end) {
+	float *out = malloc(sizeof(*out) * side * side);
+	double sum = 0;
+
+	for (uint32_t i = begin; i < end; i++) {
+		open_simplex_noise3f_grid(noise, i * (float) BENCH_SCALE, 0, 0, (float) BENCH_SCALE, 1, side, side, out);
+		for (size_t j = 0; j < (size_t) side * side; j++)
+			sum += out[j];
+	}
+
+	free(out);
+	return sum;
+}
+
+static double bench_fractal3_grid(struct osn_context const *noise, uint32_t side, uint32_t begin, uint32_t end) {
+	double *out = malloc(sizeof(*out) * side * side);
+	double sum = 0;
+
+	for (uint32_t i = begin; i < end; i++) {
+		open_simplex_noise3_fractal_grid(noise, &bench_fractal, i * BENCH_SCALE, 0, 0, BENCH_SCALE,
+			1, side, side, out, NULL);
+		for (size_t j = 0; j < (size_t) side * side; j++)
+			sum += out[j];
+	}
+
+	free(out);
+	return sum;
+}
+
+static bench_fn_t const bench_fns[] = {
+	{ "noise2", BENCH_POINT, bench_noise2, NULL },
+	{ "noise3", BENCH_POINT, bench_noise3, NULL },
+	{ "noise4", BENCH_POINT, bench_noise4, NULL },
+	{ "noise2f", BENCH_POINT, bench_noise2f, NULL },
+	{ "noise3f", BENCH_POINT, bench_noise3f, NULL },
+	{ "noise4f", BENCH_POINT, bench_noise4f, NULL },
+	{ "noise3_fractal4", BENCH_POINT, bench_fractal3, NULL },
+	{ "noise3_grid", BENCH_GRID, NULL, bench_grid3 },
+	{ "noise3f_grid", BENCH_GRID, NULL, bench_grid3f },
+	{ "noise3_fractal4_grid", BENCH_GRID, NULL, bench_fractal3_grid },
+};
+
+#define BENCH_FN_COUNT (sizeof(bench_fns) / sizeof(*bench_fns))
+
+static double bench_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* spreads the bits of a 10 bit value three apart */
+static uint32_t bench_morton_compact(uint32_t v) {
+	v &= 0x09249249;
+	v = (v ^ (v >> 2)) & 0x030c30c3;
+	v = (v ^ (v >> 4)) & 0x0300f00f;
+	v = (v ^ (v >> 8)) & 0xff0000ff;
+	v = (v ^ (v >> 16)) & 0x000003ff;
+	return v;
+}
+
+static void bench_points_new(bench_points_t *self, bench_pattern_t pattern, uint32_t side) {
+	self->side = side;
+	self->count = (size_t) side * side * side;
+	self->x = malloc(sizeof(*self->x) * self->count);
+	self->y = malloc(sizeof(*self->y) * self->count);
+	self->z = malloc(sizeof(*self->z) * self->count);
+	self->xf = malloc(sizeof(*self->xf) * self->count);
+	self->yf = malloc(sizeof(*self->yf) * self->count);
+	self->zf = malloc(sizeof(*self->zf) * self->count);
+
+	uint64_t state = 0x9e3779b97f4a7c15;
+	for (size_t i = 0; i < self->count; i++) {
+		uint32_t x, y, z;
+
+		switch (pattern) {
+		case BENCH_PATTERN_RANDOM:
+			/* xorshift, so runs are reproducible across platforms */
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			x = state % side;
+			y = (state >> 20) % side;
+			z = (state >> 40) % side;
+			break;
+		case BENCH_PATTERN_MORTON:
+			/* side is a power of two, so morton order covers the cube */
+			x = bench_morton_compact(i >> 2);
+			y = bench_morton_compact(i >> 1);
+			z = bench_morton_compact(i);
+			break;
+		default:
+			x = i / ((size_t) side * side);
+			y = i / side % side;
+			z = i % side;
+			break;
+		}
+
+		self->x[i] = x * BENCH_SCALE;
+		self->y[i] = y * BENCH_SCALE;
+		self->z[i] = z * BENCH_SCALE;
+		self->xf[i] = (float) self->x[i];
+		self->yf[i] = (float) self->y[i];
+		self->zf[i] = (float) self->z[i];
+	}
+}
+
+static void bench_points_free(bench_points_t *self) {
+	free(self->x);
+	free(self->y);
+	free(self->z);
+	free(self->xf);
+	free(self->yf);
+	free(self->zf);
+}
+
+typedef struct bench_thread_t {
+	pthread_t thread;
+	bench_fn_t const *fn;
+	struct osn_context const *noise;
+	bench_points_t const *points;
+	size_t begin;
+	size_t end;
+	double sum;
+} bench_thread_t;
+
+static void *bench_thread_run(void *arg) {
+	bench_thread_t *self = arg;
+
+	if (self->fn->kind == BENCH_POINT)
+		self->sum = self->fn->point(self->noise, self->points, self->begin, self->end);
+	else
+		self->sum = self->fn->grid(self->noise, self->points->side, self->begin, self->end);
+
+	return NULL;
+}
+
+/* returns the best wall time of BENCH_REPS runs split across nthreads */
+static double bench_run(bench_fn_t const *fn, struct osn_context const *noise,
+	bench_points_t const *points, uint32_t nthreads, double *sink) {
+	bench_thread_t *threads = calloc(nthreads, sizeof(*threads));
+	size_t total = fn->kind == BENCH_POINT ? points->count : points->side;
+	double best = INFINITY;
+
+	for (uint32_t i = 0; i < nthreads; i++) {
+		threads[i].fn = fn;
+		threads[i].noise = noise;
+		threads[i].points = points;
+		threads[i].begin = total * i / nthreads;
+		threads[i].end = total * (i + 1) / nthreads;
+	}
+
+	for (uint32_t rep = 0; rep < BENCH_REPS; rep++) {
+		double start = bench_now();
+
+		for (uint32_t i = 0; i < nthreads; i++) {
+			if (pthread_create(&threads[i].thread, NULL, bench_thread_run, &threads[i])) {
+				fprintf(stderr, "error: failed to start benchmark thread\n");
+				exit(1);
+			}
+		}
+
+		for (uint32_t i = 0; i < nthreads; i++) {
+			pthread_join(threads[i].thread, NULL);
+			*sink += threads[i].sum;
+		}
+
+		double elapsed = bench_now() - start;
+		best = elapsed < best ? elapsed : best;
+	}
+
+	free(threads);
+	return best;
+}
+
+typedef enum bench_format_t {
+	BENCH_FORMAT_CSV,
+	BENCH_FORMAT_JSON,
+} bench_format_t;
+
+typedef struct bench_output_t {
+	bench_format_t format;
+	size_t rows;
+} bench_output_t;
+
+static void bench_output_throughput(bench_output_t *self, char const *name, char const *pattern,
+	uint32_t threads, size_t samples, double seconds) {
+	double rate = samples / seconds;
+
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("benchmark,pattern,threads,samples,seconds,samples_per_sec\n");
+		printf("%s,%s,%u,%zu,%.6f,%.0f\n", name, pattern, threads, samples, seconds, rate);
+	} else {
+		printf("%s\n\t\t{ \"benchmark\": \"%s\", \"pattern\": \"%s\", \"threads\": %u, "
+			"\"samples\": %zu, \"seconds\": %.6f, \"samples_per_sec\": %.0f }",
+			self->rows ? "," : "", name, pattern, threads, samples, seconds, rate);
+	}
+
+	self->rows++;
+}
+
+static void bench_output_divergence(bench_output_t *self, char const *points, double magnitude, size_t samples,
+	double max_error, size_t near_zero, size_t sign_flips) {
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("\npoints,magnitude,samples,max_error,near_zero,sign_flips\n");
+		printf("%s,%.0f,%zu,%.3g,%zu,%zu\n", points, magnitude, samples, max_error, near_zero, sign_flips);
+	} else {
+		printf("%s\n\t\t{ \"points\": \"%s\", \"magnitude\": %.0f, \"samples\": %zu, \"max_error\": %.3g, "
+			"\"near_zero\": %zu, \"sign_flips\": %zu }",
+			self->rows ? "," : "", points, magnitude, samples, max_error, near_zero, sign_flips);
+	}
+
+	self->rows++;
+}
+
+/* compares open_simplex_noise3f against open_simplex_noise3 on points of
+ * growing magnitude, both random and on the voxel lattice the generators
+ * sample. lattice points sit on noise region boundaries far more often, and
+ * there float rounding can pick the other region, so their worst case does
+ * not shrink with magnitude. near_zero counts the points within twice the
+ * error of the zero isosurface, where a float density could land on the
+ * wrong side; sign_flips counts those that do
+ */
+static void bench_divergence(bench_output_t *out, struct osn_context const *noise, uint32_t side) {
+	static double const magnitudes[] = { 1, 16, 64, 256, 1024, 4096 };
+	size_t samples = (size_t) side * side * side;
+	uint64_t state = 0x2545f4914f6cdd1d;
+
+	for (size_t m = 0; m < 2 * sizeof(magnitudes) / sizeof(*magnitudes); m++) {
+		bool grid = m & 1;
+		double max_error = 0;
+		size_t near_zero = 0, sign_flips = 0;
+		float *p = malloc(sizeof(*p) * samples * 3);
+		double *d = malloc(sizeof(*d) * samples);
+		float *f = malloc(sizeof(*f) * samples);
+
+		double magnitude = magnitudes[m / 2];
+
+		for (size_t i = 0; i < samples * 3; i++) {
+			size_t axis = i % 3, point = i / 3;
+			size_t voxel = axis == 0 ? point / ((size_t) side * side) : axis == 1 ? point / side % side : point % side;
+
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			p[i] = grid ? (float) (magnitude + voxel * BENCH_SCALE) : (float) (magnitude * (1 + (state >> 11) * 0x1p-53));
+		}
+
+		for (size_t i = 0; i < samples; i++) {
+			d[i] = open_simplex_noise3(noise, p[i * 3], p[i * 3 + 1], p[i * 3 + 2]);
+			f[i] = open_simplex_noise3f(noise, p[i * 3], p[i * 3 + 1], p[i * 3 + 2]);
+			max_error = fmax(max_error, fabs(d[i] - f[i]));
+		}
+
+		for (size_t i = 0; i < samples; i++) {
+			if (fabs(d[i]) <= 2 * max_error) {
+				near_zero++;
+				sign_flips += (d[i] > 0) != (f[i] > 0);
+			}
+		}
+
+		bench_output_divergence(out, grid ? "grid" : "random", magnitude, samples, max_error, near_zero, sign_flips);
+
+		free(p);
+		free(d);
+		free(f);
+	}
+}
+
+static void bench_output_fractal(bench_output_t *self, char const *type, int octaves, size_t samples,
+	double max_error, double bound) {
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("\ntype,octaves,samples,max_error,bound\n");
+		printf("%s,%d,%zu,%.3g,%.3g\n", type, octaves, samples, max_error, bound);
+	} else {
+		printf("%s\n\t\t{ \"type\": \"%s\", \"octaves\": %d, \"samples\": %zu, \"max_error\": %.3g, "
+			"\"bound\": %.3g }",
+			self->rows ? "," : "", type, octaves, samples, max_error, bound);
+	}
+
+	self->rows++;
+}
+
+/* checks the double fractal grid against the point function at the bounds
+ * simplex.h states, on voxel spaced grids from a few origins, and fails the
+ * run if either is exceeded
+ */
+static void bench_fractal_divergence(bench_output_t *out, struct osn_context const *noise) {
+	static double const origins[] = { 0, -37.3, 255.9, 4096 };
+	static int const octaves[] = { 1, 2, 5, 8 };
+	uint32_t const side = 32;
+	size_t samples = (size_t) side * side * side;
+	double *grid = malloc(sizeof(*grid) * samples);
+	bool failed = false;
+
+	if (!grid) {
+		fprintf(stderr, "error: out of memory checking fractal grids\n");
+		exit(1);
+	}
+
+	for (int type = OSN_FRACTAL_FBM; type <= OSN_FRACTAL_RIDGED; type++) {
+		double bound = type == OSN_FRACTAL_RIDGED ? OSN_FRACTAL_RIDGED_TOLERANCE : OSN_GRID_TOLERANCE;
+
+		for (size_t o = 0; o < sizeof(octaves) / sizeof(*octaves); o++) {
+			struct osn_fractal fractal = bench_fractal;
+			double max_error = 0;
+
+			fractal.type = type;
+			fractal.octaves = octaves[o];
+			fractal.early_exit = 0;
+
+			for (size_t a = 0; a < sizeof(origins) / sizeof(*origins); a++) {
+				double x0 = origins[a];
+
+				if (open_simplex_noise3_fractal_grid(noise, &fractal, x0, x0, x0, BENCH_SCALE,
+					side, side, side, grid, NULL)) {
+					fprintf(stderr, "error: out of memory sampling fractal grid\n");
+					exit(1);
+				}
+
+				for (uint32_t i = 0; i < side; i++)
+					for (uint32_t j = 0; j < side; j++)
+						for (uint32_t k = 0; k < side; k++) {
+							double point = open_simplex_noise3_fractal(noise, &fractal,
+								x0 + i * BENCH_SCALE, x0 + j * BENCH_SCALE, x0 + k * BENCH_SCALE, NULL);
+							max_error = fmax(max_error, fabs(grid[((size_t) i * side + j) * side + k] - point));
+						}
+			}
+
+			bench_output_fractal(out, type == OSN_FRACTAL_RIDGED ? "ridged" : "fbm", octaves[o],
+				samples * (sizeof(origins) / sizeof(*origins)), max_error, bound);
+			failed |= max_error > bound;
+		}
+	}
+
+	free(grid);
+	if (failed) {
+		fprintf(stderr, "error: fractal grid strayed past its stated tolerance\n");
+		exit(1);
+	}
+}
+
+static void bench_output_coarse(bench_output_t *self, uint32_t refine_step, size_t noise_evals, double seconds,
+	size_t sign_errors, double max_error, double rms_error) {
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("\nrefine_step,noise_evals,seconds,sign_errors,max_error,rms_error\n");
+		printf("%u,%zu,%.6f,%zu,%.3g,%.3g\n", refine_step, noise_evals, seconds, sign_errors, max_error, rms_error);
+	} else {
+		printf("%s\n\t\t{ \"refine_step\": %u, \"noise_evals\": %zu, \"seconds\": %.6f, \"sign_errors\": %zu, "
+			"\"max_error\": %.3g, \"rms_error\": %.3g }",
+			self->rows ? "," : "", refine_step, noise_evals, seconds, sign_errors, max_error, rms_error);
+	}
+
+	self->rows++;
+}
+
+/* generates the default chunk coarsely at each refine_step and compares it
+ * against sampling every voxel. timing runs leave measure_error off, as it
+ * samples the full field and interpolates uniform cells too
+ */
+static void bench_coarse(bench_output_t *out, struct osn_context const *noise) {
+	uint64_t *occ = malloc(sizeof(*occ) * VOXEL_OCC_WORDS);
+
+	for (uint32_t refine_step = 1; refine_step <= 8; refine_step <<= 1) {
+		gen_config_t config = {
+			.mode = GEN_MODE_COARSE,
+			.lattice_step = 8,
+			.refine_step = refine_step,
+			.refine_margin = 0.02f,
+			.measure_error = true,
+		};
+		gen_stats_t errors, stats;
+		double best = INFINITY;
+
+		gen_chunk(&config, noise, bench_origin, occ, &errors, NULL);
+
+		config.measure_error = false;
+		for (uint32_t rep = 0; rep < BENCH_REPS; rep++) {
+			double start = bench_now();
+			gen_chunk(&config, noise, bench_origin, occ, &stats, NULL);
+			double elapsed = bench_now() - start;
+			best = elapsed < best ? elapsed : best;
+		}
+
+		bench_output_coarse(out, refine_step, stats.noise_evals, best,
+			errors.sign_errors, errors.max_error, errors.rms_error);
+	}
+
+	free(occ);
+}
+
+static void bench_output_build(bench_output_t *self, char const *name, size_t solid, size_t nodes, double seconds) {
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("\nbuilder,solid,nodes,seconds\n");
+		printf("%s,%zu,%zu,%.6f\n", name, solid, nodes, seconds);
+	} else {
+		printf("%s\n\t\t{ \"builder\": \"%s\", \"solid\": %zu, \"nodes\": %zu, \"seconds\": %.6f }",
+			self->rows ? "," : "", name, solid, nodes, seconds);
+	}
+
+	self->rows++;
+}
+
+/* builds the default chunk voxel by voxel through voxel_set and in one pass
+ * through voxel_build
+ */
+static void bench_build(bench_output_t *out, struct osn_context const *noise) {
+	static gen_config_t const config = { .mode = GEN_MODE_FULL };
+	uint64_t *occ = malloc(sizeof(*occ) * VOXEL_OCC_WORDS);
+	gen_stats_t stats;
+
+	gen_chunk(&config, noise, bench_origin, occ, &stats, NULL);
+
+	for (uint32_t bulk = 0; bulk < 2; bulk++) {
+		double best = INFINITY;
+		size_t nodes = 0;
+
+		for (uint32_t rep = 0; rep < BENCH_REPS; rep++) {
+			voxel_cache_t cache;
+			voct_node_t root = { .is_leaf = false, .depth = VOXEL_OCC_DEPTH + 1 };
+
+			voxel_cache_new(&cache);
+			double start = bench_now();
+
+			if (bulk) {
+				voxel_build(&cache, &root, occ);
+			} else {
+				for (uint32_t i = 0; i < VOXEL_OCC_SIZE; i++)
+					for (uint32_t j = 0; j < VOXEL_OCC_SIZE; j++)
+						for (uint32_t k = 0; k < VOXEL_OCC_SIZE; k++)
+							if (voxel_occ_get(occ, i, j, k))
+								voxel_set(&cache, &root, i, j, k);
+			}
+
+			double elapsed = bench_now() - start;
+			best = elapsed < best ? elapsed : best;
+			nodes = cache.pool.live;
+			voxel_cache_free(&cache);
+		}
+
+		bench_output_build(out, bulk ? "voxel_build" : "voxel_set", stats.solid_count, nodes, best);
+	}
+
+	free(occ);
+}
+
+static void bench_output_svo(bench_output_t *self, char const *name, size_t bytes, double build, double find,
+	double visible, size_t hidden, size_t mismatched) {
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("\ntree,bytes,build_seconds,find_seconds,visible_seconds,hidden,mismatched\n");
+		printf("%s,%zu,%.6f,%.6f,%.6f,%zu,%zu\n", name, bytes, build, find, visible, hidden, mismatched);
+	} else {
+		printf("%s\n\t\t{ \"tree\": \"%s\", \"bytes\": %zu, \"build_seconds\": %.6f, \"find_seconds\": %.6f, "
+			"\"visible_seconds\": %.6f, \"hidden\": %zu, \"mismatched\": %zu }",
+			self->rows ? "," : "", name, bytes, build, find, visible, hidden, mismatched);
+	}
+
+	self->rows++;
+}
+
+/* builds the default chunk voxel by voxel into a voct tree and an svo, then
+ * times finding every voxel and the visibility pass in each. mismatched
+ * counts voxels whose solid or hidden state differs from the voct tree
+ */
+static void bench_svo(bench_output_t *out, struct osn_context const *noise) {
+	static gen_config_t const config = { .mode = GEN_MODE_FULL };
+	uint64_t *occ = malloc(sizeof(*occ) * VOXEL_OCC_WORDS);
+	uint32_t const n = VOXEL_OCC_SIZE;
+	voxel_cache_t cache;
+	voct_node_t root = { .is_leaf = false, .depth = VOXEL_OCC_DEPTH + 1 };
+	svo_t svo;
+	gen_stats_t stats;
+	size_t found = 0, hidden[2] = { 0 }, mismatched = 0;
+
+	gen_chunk(&config, noise, bench_origin, occ, &stats, NULL);
+	voxel_cache_new(&cache);
+	svo_new(&svo, VOXEL_OCC_DEPTH);
+
+	double start = bench_now();
+	for (uint32_t i = 0; i < n; i++)
+		for (uint32_t j = 0; j < n; j++)
+			for (uint32_t k = 0; k < n; k++)
+				if (voxel_occ_get(occ, i, j, k))
+					voxel_set(&cache, &root, i, j, k);
+	double voct_build = bench_now() - start;
+
+	start = bench_now();
+	for (uint32_t i = 0; i < n; i++)
+		for (uint32_t j = 0; j < n; j++)
+			for (uint32_t k = 0; k < n; k++)
+				if (voxel_occ_get(occ, i, j, k))
+					svo_set(&svo, i, j, k);
+	double svo_build = bench_now() - start;
+
+	start = bench_now();
+	for (uint32_t i = 0; i < n; i++)
+		for (uint32_t j = 0; j < n; j++)
+			for (uint32_t k = 0; k < n; k++)
+				found += voxel_find(&root, 0, i, j, k) != NULL;
+	double voct_find = bench_now() - start;
+
+	start = bench_now();
+	for (uint32_t i = 0; i < n; i++)
+		for (uint32_t j = 0; j < n; j++)
+			for (uint32_t k = 0; k < n; k++)
+				found += svo_find(&svo, 0, i, j, k);
+	double svo_find_seconds = bench_now() - start;
+
+	start = bench_now();
+	voxel_set_visible(&root);
+	double voct_visible = bench_now() - start;
+
+	start = bench_now();
+	svo_set_visible(&svo);
+	double svo_visible = bench_now() - start;
+
+	for (uint32_t i = 0; i < n; i++) {
+		for (uint32_t j = 0; j < n; j++) {
+			for (uint32_t k = 0; k < n; k++) {
+				voxel_t const *voxel = voxel_find(&root, 0, i, j, k);
+				bool voct_hidden = voxel && voxel->scale & BLOCK_FLAG_HIDDEN;
+				bool svo_hidden_voxel = svo_hidden(&svo, i, j, k);
+
+				hidden[0] += voct_hidden;
+				hidden[1] += svo_hidden_voxel;
+				mismatched += (voxel != NULL) != svo_find(&svo, 0, i, j, k) || voct_hidden != svo_hidden_voxel;
+			}
+		}
+	}
+
+	bench_output_svo(out, "voct", voxel_cache_bytes(&cache), voct_build, voct_find, voct_visible, hidden[0], 0);
+	bench_output_svo(out, "svo", svo_bytes(&svo), svo_build, svo_find_seconds, svo_visible, hidden[1], mismatched);
+
+	/* both trees were searched for every voxel, so this is twice solid */
+	if (found != 2 * stats.solid_count)
+		fprintf(stderr, "warning: found %zu voxels, expected %zu\n", found / 2, stats.solid_count);
+
+	svo_free(&svo);
+	voxel_cache_free(&cache);
+	free(occ);
+}
+
+static void bench_output_mesh(bench_output_t *self, char const *name, size_t cubes, size_t quads, double seconds) {
+	if (self->format == BENCH_FORMAT_CSV) {
+		if (!self->rows)
+			printf("\npass,cubes,quads,seconds\n");
+		printf("%s,%zu,%zu,%.6f\n", name, cubes, quads, seconds);
+	} else {
+		printf("%s\n\t\t{ \"pass\": \"%s\", \"cubes\": %zu, \"quads\": %zu, \"seconds\": %.6f }",
+			self->rows ? "," : "", name, cubes, quads, seconds);
+	}
+
+	self->rows++;
+}
+
+/* counts the instances the default chunk draws as cubes and as faces */
+static void bench_mesh_count(voct_node_t const *root, voxel_packed_t *instances, size_t *cubes, size_t *faces) {
+	voxel_draw_list_t list = {
+		.instances = instances,
+		.capacity = (size_t) VOXEL_OCC_SIZE * VOXEL_OCC_SIZE * VOXEL_OCC_SIZE,
+	};
+
+	voxel_emit(&list, root);
+	*cubes = list.count;
+
+	list.count = 0;
+	for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++) {
+		list.faces = BLOCK_FLAG_FACE(face);
+		voxel_emit(&list, root);
+	}
+	*faces = list.count;
+}
+
+/* times the passes that turn the default chunk's octree into instances, with
+ * the instance counts after each, against meshing its occupancy bitmap
+ * directly with voxel_mesh, which only makes quads
+ */
+static void bench_mesh(bench_output_t *out, struct osn_context const *noise) {
+	static gen_config_t const config = { .mode = GEN_MODE_FULL };
+	uint64_t *occ = malloc(sizeof(*occ) * VOXEL_OCC_WORDS);
+	voxel_packed_t *instances = malloc(sizeof(*instances) * VOXEL_OCC_SIZE * VOXEL_OCC_SIZE * VOXEL_OCC_SIZE);
+	voxel_cache_t cache;
+	voct_node_t root = { .is_leaf = false, .depth = VOXEL_OCC_DEPTH + 1 };
+	gen_stats_t stats;
+	double visible = INFINITY, greedy = INFINITY;
+
+	gen_chunk(&config, noise, bench_origin, occ, &stats, NULL);
+	voxel_cache_new(&cache);
+	voxel_build(&cache, &root, occ);
+
+	for (uint32_t rep = 0; rep < BENCH_REPS; rep++) {
+		double start = bench_now();
+		voxel_set_visible(&root);
+		double mid = bench_now();
+		voxel_greedy(&root);
+		double end = bench_now();
+
+		visible = mid - start < visible ? mid - start : visible;
+		greedy = end - mid < greedy ? end - mid : greedy;
+	}
+
+	size_t cubes, faces;
+	voxel_set_visible(&root);
+	bench_mesh_count(&root, instances, &cubes, &faces);
+	bench_output_mesh(out, "voxel_set_visible", cubes, faces, visible);
+
+	voxel_greedy(&root);
+	bench_mesh_count(&root, instances, &cubes, &faces);
+	bench_output_mesh(out, "voxel_greedy", cubes, faces, greedy);
+
+	/* one quad per unit face is the most a chunk can have */
+	voxel_mesh_t mesh = { .capacity = (size_t) VOXEL_OCC_SIZE * VOXEL_OCC_SIZE * VOXEL_OCC_SIZE * 3 };
+	mesh.quads = malloc(sizeof(*mesh.quads) * mesh.capacity);
+	double binary = INFINITY;
+
+	for (uint32_t rep = 0; rep < BENCH_REPS; rep++) {
+		mesh.count = 0;
+		double start = bench_now();
+		voxel_mesh(&mesh, occ);
+		double elapsed = bench_now() - start;
+		binary = elapsed < binary ? elapsed : binary;
+	}
+
+	bench_output_mesh(out, "voxel_mesh", 0, mesh.count, binary);
+
+	free(mesh.quads);
+	voxel_cache_free(&cache);
+	free(instances);
+	free(occ);
+}
+
+static void usage(char const *argv0) {
+	fprintf(stderr, "usage: %s [-f csv|json] [-s side] [-t threads]\n", argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	bench_output_t out = { .format = BENCH_FORMAT_CSV };
+	uint32_t side = 64;
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:s:t:")) != -1) {
+		switch (opt) {
+		case 'f':
+			if (!strcmp(optarg, "csv"))
+				out.format = BENCH_FORMAT_CSV;
+			else if (!strcmp(optarg, "json"))
+				out.format = BENCH_FORMAT_JSON;
+			else
+				usage(argv[0]);
+			break;
+		case 's':
+			side = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			nthreads = strtol(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	/* morton order needs a power of two side, at most 1024 */
+	if (!side || side > 1024 || (side & (side - 1))) {
+		fprintf(stderr, "error: side must be a power of two up to 1024\n");
+		exit(1);
+	}
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	struct osn_context *noise;
+	if (open_simplex_noise(1, &noise)) {
+		fprintf(stderr, "error: failed to create noise context\n");
+		exit(1);
+	}
+
+	uint32_t thread_counts[] = { 1, (uint32_t) nthreads };
+	uint32_t thread_runs = nthreads > 1 ? 2 : 1;
+	double sink = 0;
+
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("{\n\t\"throughput\": [");
+
+	for (bench_pattern_t pattern = 0; pattern < BENCH_PATTERN_COUNT; pattern++) {
+		bench_points_t points;
+		bench_points_new(&points, pattern, side);
+
+		for (size_t i = 0; i < BENCH_FN_COUNT; i++) {
+			/* grids only ever walk the cube in order */
+			if (bench_fns[i].kind == BENCH_GRID && pattern != BENCH_PATTERN_LINEAR)
+				continue;
+
+			for (uint32_t t = 0; t < thread_runs; t++) {
+				double seconds = bench_run(&bench_fns[i], noise, &points, thread_counts[t], &sink);
+				bench_output_throughput(&out, bench_fns[i].name, bench_pattern_names[pattern],
+					thread_counts[t], points.count, seconds);
+			}
+		}
+
+		bench_points_free(&points);
+	}
+
+	out.rows = 0;
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t],\n\t\"divergence\": [");
+
+	bench_divergence(&out, noise, side);
+
+	out.rows = 0;
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t],\n\t\"fractal_divergence\": [");
+
+	bench_fractal_divergence(&out, noise);
+
+	out.rows = 0;
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t],\n\t\"coarse\": [");
+
+	bench_coarse(&out, noise);
+
+	out.rows = 0;
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t],\n\t\"build\": [");
+
+	bench_build(&out, noise);
+
+	out.rows = 0;
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t],\n\t\"svo\": [");
+
+	bench_svo(&out, noise);
+
+	out.rows = 0;
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t],\n\t\"mesh\": [");
+
+	bench_mesh(&out, noise);
+
+	if (out.format == BENCH_FORMAT_JSON)
+		printf("\n\t]\n}\n");
+
+	/* keeps the sums, and so the noise calls, from being optimised out */
+	fprintf(stderr, "checksum: %g\n", sink);
+
+	open_simplex_noise_free(noise);
+	return 0;
+}
@@ -0,0 +1,101 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "chunk.h"
+
+static double chunk_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void chunk_gen(chunk_t *self, gen_config_t const *config, int64_t seed,
+	int32_t x, int32_t y, int32_t z, task_pool_t *tasks) {
+	voxel_cache_new(&self->cache);
+	self->tree.depth = VOXEL_OCC_DEPTH + 1;
+	self->tree.is_leaf = false;
+	memset(self->tree.children, 0, sizeof(self->tree.children));
+
+	self->origin[0] = x * GEN_CHUNK_SIZE;
+	self->origin[1] = y * GEN_CHUNK_SIZE;
+	self->origin[2] = z * GEN_CHUNK_SIZE;
+
+	struct osn_context const *simplex = gen_noise_get(seed);
+	if (!simplex)
+		exit(1);
+
+	/* the tree and its instances stay chunk local; whoever draws them
+	 * offsets them by origin
+	 */
+	double start = chunk_now();
+	gen_tree(config, simplex, self->origin, &self->cache, &self->tree, &self->stats, tasks);
+
+	double visible = chunk_now();
+	voxel_set_visible(&self->tree);
+
+	double greedy = chunk_now();
+	self->merged = voxel_greedy(&self->tree);
+
+	double emit = chunk_now();
+	size_t counts[VOXEL_FACE_COUNT] = { 0 };
+	voxel_count_faces(&self->tree, counts);
+
+	size_t total = 0;
+	for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++)
+		total += counts[face];
+
+	self->to_draw = malloc(sizeof(*self->to_draw) * total);
+	if (total && !self->to_draw) {
+		fprintf(stderr, "error: out of memory allocating draw list\n");
+		exit(1);
+	}
+
+	voxel_draw_list_t list = {
+		.instances = self->to_draw,
+		.capacity = total,
+	};
+	for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++) {
+		self->face_first[face] = list.count;
+		list.faces = BLOCK_FLAG_FACE(face);
+		voxel_emit(&list, &self->tree);
+		self->face_count[face] = list.count - self->face_first[face];
+	}
+	self->to_draw_count = list.count;
+
+	double end = chunk_now();
+	self->timing = (chunk_timing_t){
+		.gen = visible - start,
+		.visible = greedy - visible,
+		.greedy = emit - greedy,
+		.emit = end - emit,
+	};
+}
+
+void chunk_release_draw(chunk_t *self) {
+	free(self->to_draw);
+	self->to_draw = NULL;
+	self->to_draw_count = 0;
+	memset(self->face_first, 0, sizeof(self->face_first));
+	memset(self->face_count, 0, sizeof(self->face_count));
+}
+
+void chunk_free(chunk_t *self) {
+	chunk_release_draw(self);
+	voxel_cache_free(&self->cache);
+	memset(self->tree.children, 0, sizeof(self->tree.children));
+	self->tree.is_leaf = false;
+}
+
+void chunk_print(chunk_t const *self) {
+	gen_stats_print(&self->stats);
+	fprintf(stderr, "to_draw_count: %lu faces, %lu voxels merged\n", self->to_draw_count, self->merged);
+	voxel_cache_print(&self->cache);
+}
@@ -0,0 +1,62 @@
+#ifndef CHUNK_H__
+#define CHUNK_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "voct.h"
+#include "gen.h"
+#include "task.h"
+
+/* one chunk of the world taken from noise to instances ready to upload:
+ * generation, visibility, greedy merging and extraction. needs no display,
+ * so anything from the app to a headless box can run it
+ */
+
+/* seconds spent in each stage of chunk_gen */
+typedef struct chunk_timing_t {
+	double gen;
+	double visible;
+	double greedy;
+	double emit;
+} chunk_timing_t;
+
+typedef struct chunk_t {
+	/* world position of voxel 0, 0, 0 */
+	int32_t origin[3];
+
+	voxel_cache_t cache;
+	voct_node_t tree;
+
+	/* one instance per open face, grouped by face so each group is drawn
+	 * as quads facing the same way. sized to the visible faces; callers
+	 * may free it with chunk_release_draw once it is uploaded, which also
+	 * clears the counts, so keep any ranges still needed for drawing
+	 */
+	voxel_packed_t *to_draw;
+	size_t to_draw_count;
+	size_t face_first[VOXEL_FACE_COUNT];
+	size_t face_count[VOXEL_FACE_COUNT];
+
+	gen_stats_t stats;
+	/* leaves absorbed by greedy merging */
+	size_t merged;
+	chunk_timing_t timing;
+} chunk_t;
+
+/* generates the chunk at chunk coordinates x, y, z from the noise of seed
+ * and extracts its instances. self needs no setup beforehand. tasks may be
+ * NULL
+ */
+void chunk_gen(chunk_t *self, gen_config_t const *config, int64_t seed,
+	int32_t x, int32_t y, int32_t z, task_pool_t *tasks);
+
+/* frees the instances, keeping the tree */
+void chunk_release_draw(chunk_t *self);
+
+void chunk_free(chunk_t *self);
+
+void chunk_print(chunk_t const *self);
+
+#endif
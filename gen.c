@@ -0,0 +1,752 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "gen.h"
+
+/* lattice points run from 0 to GEN_CHUNK_SIZE inclusive so that the last
+ * cell along each axis has its far corners
+ */
+#define LATTICE_SIZE (GEN_CHUNK_SIZE + 1)
+
+typedef struct gen_state_t {
+	gen_config_t const *config;
+	struct osn_context const *noise;
+	/* world position of the chunk's low corner in voxels */
+	int32_t origin[3];
+	uint64_t *occ;
+	gen_stats_t *stats;
+
+	/* noise values at lattice points from plane density_x on; only sampled
+	 * points are valid
+	 */
+	float *density;
+	uint32_t density_x;
+	/* one plane of grid output */
+	float *scratch;
+
+	/* full resolution field when measuring error */
+	float *reference;
+	double error_sq;
+
+	/* GEN_MODE_HEIGHTMAP: lowest and highest column height over every
+	 * aligned square of 2^level columns, for each level
+	 */
+	uint16_t *height_min;
+	uint16_t *height_max;
+
+	/* splits generation into tasks when set */
+	task_pool_t *tasks;
+} gen_state_t;
+
+/* voxel planes per task when sampling every voxel */
+#define GEN_SLAB_SIZE 8
+
+typedef struct gen_slab_t {
+	gen_state_t state;
+	gen_stats_t stats;
+	uint32_t begin;
+	uint32_t end;
+	void (*fn)(gen_state_t *self, uint32_t begin, uint32_t end);
+} gen_slab_t;
+
+/* one child of the chunk's node, built into a cache of its own */
+typedef struct gen_octant_t {
+	gen_state_t state;
+	gen_stats_t stats;
+	voxel_cache_t cache;
+	uint32_t x, y, z;
+	uint8_t depth;
+	voct_node_t *node;
+} gen_octant_t;
+
+typedef struct gen_noise_entry_t {
+	int64_t seed;
+	struct osn_context *ctx;
+	struct gen_noise_entry_t *next;
+} gen_noise_entry_t;
+
+/* seed keyed registry of noise contexts. there are only ever a handful of
+ * seeds, so a list is plenty; the lock is only taken once per chunk
+ */
+static pthread_mutex_t gen_noise_lock = PTHREAD_MUTEX_INITIALIZER;
+static gen_noise_entry_t *gen_noise_entries = NULL;
+
+struct osn_context const *gen_noise_get(int64_t seed) {
+	struct osn_context *ret = NULL;
+
+	pthread_mutex_lock(&gen_noise_lock);
+
+	for (gen_noise_entry_t *entry = gen_noise_entries; entry && !ret; entry = entry->next)
+		if (entry->seed == seed)
+			ret = entry->ctx;
+
+	if (!ret) {
+		gen_noise_entry_t *entry = malloc(sizeof(*entry));
+		if (entry && !open_simplex_noise(seed, &entry->ctx)) {
+			entry->seed = seed;
+			entry->next = gen_noise_entries;
+			gen_noise_entries = entry;
+			ret = entry->ctx;
+		} else {
+			fprintf(stderr, "gen: failed to build noise context for seed %ld\n", (long) seed);
+			free(entry);
+		}
+	}
+
+	pthread_mutex_unlock(&gen_noise_lock);
+	return ret;
+}
+
+void gen_noise_release(void) {
+	pthread_mutex_lock(&gen_noise_lock);
+
+	while (gen_noise_entries) {
+		gen_noise_entry_t *entry = gen_noise_entries;
+		gen_noise_entries = entry->next;
+		open_simplex_noise_free(entry->ctx);
+		free(entry);
+	}
+
+	pthread_mutex_unlock(&gen_noise_lock);
+}
+
+/* noise coordinate of a voxel of the chunk along axis. the sum is taken
+ * before converting, so negative origins work and chunks line up exactly
+ */
+static inline double gen_coord(gen_state_t const *self, uint8_t axis, uint32_t v) {
+	return ((int64_t) self->origin[axis] + v) / (double) GEN_NOISE_SCALE;
+}
+
+static inline size_t lattice_index(uint32_t x, uint32_t y, uint32_t z) {
+	return ((size_t) x * LATTICE_SIZE + y) * LATTICE_SIZE + z;
+}
+
+static inline float *gen_density(gen_state_t *self, uint32_t x, uint32_t y, uint32_t z) {
+	return self->density + lattice_index(x - self->density_x, y, z);
+}
+
+/* samples a 1 * n * n plane of voxels spaced step apart into out, as plain
+ * noise or as the configured fractal sum. unless exact is set, fractal
+ * points stop taking octaves once their sign is settled. returns the number
+ * of noise samples taken
+ */
+static size_t gen_plane(gen_state_t *self, uint32_t x, uint32_t y, uint32_t z, uint32_t step, uint32_t n,
+	float *out, bool exact) {
+	if (self->config->fractal.octaves <= 1) {
+		open_simplex_noise3f_grid(self->noise,
+			gen_coord(self, 0, x), gen_coord(self, 1, y), gen_coord(self, 2, z), step / GEN_NOISE_SCALE,
+			1, n, n, out);
+		return (size_t) n * n;
+	}
+
+	struct osn_fractal fractal = self->config->fractal;
+	struct osn_fractal_stats fractal_stats = { 0 };
+	fractal.early_exit = !exact;
+	fractal.threshold = 0;
+
+	if (open_simplex_noise3f_fractal_grid(self->noise, &fractal,
+		gen_coord(self, 0, x), gen_coord(self, 1, y), gen_coord(self, 2, z), step / GEN_NOISE_SCALE,
+		1, n, n, out, &fractal_stats)) {
+		fprintf(stderr, "error: out of memory sampling fractal noise\n");
+		exit(1);
+	}
+
+	self->stats->octaves_skipped += fractal_stats.skipped;
+	return fractal_stats.evals;
+}
+
+/* samples a planes * n * n block of lattice points spaced step voxels apart.
+ * points one voxel apart are never interpolated, only tested for sign, so
+ * they may stop taking octaves early unless the error is being measured
+ */
+static void gen_sample(gen_state_t *self, uint32_t x, uint32_t y, uint32_t z, uint32_t step,
+	uint32_t planes, uint32_t n) {
+	bool exact = step != 1 || self->config->measure_error;
+
+	for (uint32_t i = 0; i < planes; i++) {
+		self->stats->noise_evals += gen_plane(self, x + i * step, y, z, step, n, self->scratch, exact);
+
+		for (uint32_t j = 0; j < n; j++)
+			for (uint32_t k = 0; k < n; k++)
+				*gen_density(self, x + i * step, y + j * step, z + k * step) = self->scratch[j * n + k];
+	}
+}
+
+/* sets len consecutive bits along z starting at z */
+static void gen_occ_fill_run(uint64_t *occ, uint32_t x, uint32_t y, uint32_t z, uint32_t len) {
+	while (len) {
+		uint32_t bit = z & 63;
+		uint32_t count = len < 64 - bit ? len : 64 - bit;
+		uint64_t mask = count == 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << count) - 1) << bit;
+
+		occ[voxel_occ_index(x, y, z)] |= mask;
+		z += count;
+		len -= count;
+	}
+}
+
+/* fills the voxels of a cell from its corner values. corners are indexed
+ * x << 2 | y << 1 | z. a cell owns the voxels [x, x + s) on each axis; the
+ * far corners belong to its neighbours
+ */
+static void gen_fill(gen_state_t *self, uint32_t x, uint32_t y, uint32_t z, uint32_t s, float const v[8], bool uniform) {
+	if (uniform && !self->config->measure_error) {
+		if (v[0] > 0)
+			for (uint32_t i = 0; i < s; i++)
+				for (uint32_t j = 0; j < s; j++)
+					gen_occ_fill_run(self->occ, x + i, y + j, z, s);
+		return;
+	}
+
+	for (uint32_t i = 0; i < s; i++) {
+		float fx = i / (float) s;
+		for (uint32_t j = 0; j < s; j++) {
+			float fy = j / (float) s;
+			for (uint32_t k = 0; k < s; k++) {
+				float fz = k / (float) s;
+
+				float c00 = v[0] * (1 - fz) + v[1] * fz;
+				float c01 = v[2] * (1 - fz) + v[3] * fz;
+				float c10 = v[4] * (1 - fz) + v[5] * fz;
+				float c11 = v[6] * (1 - fz) + v[7] * fz;
+				float t = (c00 * (1 - fy) + c01 * fy) * (1 - fx) + (c10 * (1 - fy) + c11 * fy) * fx;
+
+				if (t > 0)
+					voxel_occ_set(self->occ, x + i, y + j, z + k);
+
+				if (self->reference) {
+					float ref = self->reference[((size_t) (x + i) * GEN_CHUNK_SIZE + y + j) * GEN_CHUNK_SIZE + z + k];
+					float err = fabsf(t - ref);
+
+					self->error_sq += (double) err * err;
+					if (err > self->stats->max_error)
+						self->stats->max_error = err;
+					if ((t > 0) != (ref > 0))
+						self->stats->sign_errors++;
+				}
+			}
+		}
+	}
+}
+
+static void gen_cell(gen_state_t *self, uint32_t x, uint32_t y, uint32_t z, uint32_t s) {
+	float v[8];
+	float min = INFINITY, max = -INFINITY, min_abs = INFINITY;
+
+	for (uint8_t i = 0; i < 8; i++) {
+		v[i] = *gen_density(self, x + (i >> 2 & 1) * s, y + (i >> 1 & 1) * s, z + (i & 1) * s);
+		min = fminf(min, v[i]);
+		max = fmaxf(max, v[i]);
+		min_abs = fminf(min_abs, fabsf(v[i]));
+	}
+
+	/* with every corner on one side of zero, trilinear interpolation can not
+	 * change sign inside the cell. the margin catches features smaller than
+	 * the cell that the corners miss entirely
+	 */
+	bool uniform = (min > 0 || max <= 0) && min_abs > self->config->refine_margin;
+
+	if (uniform || s <= self->config->refine_step) {
+		gen_fill(self, x, y, z, s, v, uniform);
+		return;
+	}
+
+	/* refine the whole cell in one batch rather than halving it level by
+	 * level; small grids spend most of their time in per-call overhead
+	 */
+	uint32_t h = self->config->refine_step;
+	uint32_t n = s / h;
+	gen_sample(self, x, y, z, h, n + 1, n + 1);
+
+	for (uint32_t i = 0; i < n; i++)
+		for (uint32_t j = 0; j < n; j++)
+			for (uint32_t k = 0; k < n; k++)
+				gen_cell(self, x + i * h, y + j * h, z + k * h, h);
+}
+
+static void gen_stats_add(gen_stats_t *self, gen_stats_t const *other) {
+	self->noise_evals += other->noise_evals;
+	self->solid_count += other->solid_count;
+	self->octaves_skipped += other->octaves_skipped;
+	self->bound_evals += other->bound_evals;
+	self->nodes_solid += other->nodes_solid;
+	self->nodes_empty += other->nodes_empty;
+	self->nodes_sampled += other->nodes_sampled;
+	self->sign_errors += other->sign_errors;
+	self->max_error = other->max_error > self->max_error ? other->max_error : self->max_error;
+}
+
+/* a task's own copy of the state, sharing everything but its stats,
+ * scratch and density, and never splitting further
+ */
+static gen_state_t gen_state_fork(gen_state_t const *self, gen_stats_t *stats) {
+	gen_state_t ret = {
+		.config = self->config,
+		.noise = self->noise,
+		.origin = { self->origin[0], self->origin[1], self->origin[2] },
+		.occ = self->occ,
+		.stats = stats,
+		.scratch = malloc(sizeof(float) * LATTICE_SIZE * LATTICE_SIZE),
+		.reference = self->reference,
+	};
+
+	memset(stats, 0, sizeof(*stats));
+	if (!ret.scratch) {
+		fprintf(stderr, "error: out of memory forking generation task\n");
+		exit(1);
+	}
+
+	return ret;
+}
+
+static void gen_planes_full(gen_state_t *self, uint32_t begin, uint32_t end) {
+	for (uint32_t i = begin; i < end; i++) {
+		self->stats->noise_evals += gen_plane(self, i, 0, 0, 1, GEN_CHUNK_SIZE, self->scratch, false);
+
+		for (uint32_t j = 0; j < GEN_CHUNK_SIZE; j++)
+			for (uint32_t k = 0; k < GEN_CHUNK_SIZE; k++)
+				if (self->scratch[j * GEN_CHUNK_SIZE + k] > 0)
+					voxel_occ_set(self->occ, i, j, k);
+	}
+}
+
+/* the cells of [begin, end) along x. only the lattice planes from begin to
+ * end are kept, so neighbouring slabs each sample the plane between them
+ */
+static void gen_cells_coarse(gen_state_t *self, uint32_t begin, uint32_t end) {
+	uint32_t step = self->config->lattice_step;
+
+	self->density = malloc(sizeof(*self->density) * (end - begin + 1) * LATTICE_SIZE * LATTICE_SIZE);
+	self->density_x = begin;
+	if (!self->density) {
+		fprintf(stderr, "error: out of memory sampling lattice\n");
+		exit(1);
+	}
+
+	gen_sample(self, begin, 0, 0, step, (end - begin) / step + 1, GEN_CHUNK_SIZE / step + 1);
+
+	for (uint32_t i = begin; i < end; i += step)
+		for (uint32_t j = 0; j < GEN_CHUNK_SIZE; j += step)
+			for (uint32_t k = 0; k < GEN_CHUNK_SIZE; k += step)
+				gen_cell(self, i, j, k, step);
+
+	free(self->density);
+	self->density = NULL;
+}
+
+static void gen_slab_run(void *arg) {
+	gen_slab_t *slab = arg;
+	slab->fn(&slab->state, slab->begin, slab->end);
+}
+
+/* runs fn over slabs of width voxels along x, one task each. x is the
+ * outermost index of the bitmap, so slabs write disjoint words and need no
+ * locking
+ */
+static void gen_slabs(gen_state_t *self, uint32_t width, void (*fn)(gen_state_t *self, uint32_t begin, uint32_t end)) {
+	if (!self->tasks) {
+		fn(self, 0, GEN_CHUNK_SIZE);
+		return;
+	}
+
+	gen_slab_t slabs[GEN_CHUNK_SIZE / GEN_SLAB_SIZE];
+	uint32_t count = GEN_CHUNK_SIZE / (width > GEN_SLAB_SIZE ? width : GEN_SLAB_SIZE);
+	task_group_t group = { 0 };
+
+	for (uint32_t i = 0; i < count; i++) {
+		slabs[i].state = gen_state_fork(self, &slabs[i].stats);
+		slabs[i].begin = i * (GEN_CHUNK_SIZE / count);
+		slabs[i].end = (i + 1) * (GEN_CHUNK_SIZE / count);
+		slabs[i].fn = fn;
+		task_spawn(self->tasks, &group, gen_slab_run, slabs + i);
+	}
+
+	task_wait(self->tasks, &group);
+
+	for (uint32_t i = 0; i < count; i++) {
+		gen_stats_add(self->stats, &slabs[i].stats);
+		self->error_sq += slabs[i].state.error_sq;
+		free(slabs[i].state.scratch);
+	}
+}
+
+static void gen_chunk_full(gen_state_t *self) {
+	gen_slabs(self, GEN_SLAB_SIZE, gen_planes_full);
+}
+
+/* cells never cross slabs as long as slabs are at least a cell wide */
+static void gen_chunk_coarse(gen_state_t *self) {
+	if (self->config->measure_error) {
+		size_t plane = GEN_CHUNK_SIZE * GEN_CHUNK_SIZE;
+		self->reference = malloc(sizeof(*self->reference) * plane * GEN_CHUNK_SIZE);
+		if (!self->reference) {
+			fprintf(stderr, "error: out of memory sampling reference field\n");
+			exit(1);
+		}
+		for (uint32_t i = 0; i < GEN_CHUNK_SIZE; i++)
+			gen_plane(self, i, 0, 0, 1, GEN_CHUNK_SIZE, self->reference + i * plane, true);
+	}
+
+	gen_slabs(self, self->config->lattice_step, gen_cells_coarse);
+
+	if (self->reference) {
+		self->stats->error_measured = true;
+		self->stats->rms_error = sqrt(self->error_sq / ((double) GEN_CHUNK_SIZE * GEN_CHUNK_SIZE * GEN_CHUNK_SIZE));
+	}
+
+	free(self->reference);
+}
+
+#define HEIGHT_LEVELS 8
+
+/* offset of a level within the height pyramid */
+static inline size_t height_index(uint8_t level, uint32_t x, uint32_t z) {
+	size_t offset = 0;
+	for (uint8_t i = 0; i < level; i++)
+		offset += (GEN_CHUNK_SIZE >> i) * (GEN_CHUNK_SIZE >> i);
+	return offset + (size_t) (x >> level) * (GEN_CHUNK_SIZE >> level) + (z >> level);
+}
+
+/* number of solid voxels at the bottom of a column. the height is taken in
+ * world space, so columns run on through the chunks above and below
+ */
+static uint16_t gen_column_height(gen_state_t const *self, uint32_t x, uint32_t z) {
+	gen_config_t const *config = self->config;
+	uint8_t octaves = config->height_octaves ? config->height_octaves : 1;
+	float amp = 1, sum = 0, norm = 0;
+	double u = gen_coord(self, 0, x), v = gen_coord(self, 2, z);
+
+	for (uint8_t i = 0; i < octaves; i++) {
+		sum += amp * open_simplex_noise2f(self->noise, u, v);
+		norm += amp;
+		u *= 2;
+		v *= 2;
+		amp *= 0.5f;
+	}
+
+	/* y < h holds for the first ceil(h) voxels */
+	float h = ceilf(config->height_base + config->height_amplitude * sum / norm) - self->origin[1];
+	return h <= 0 ? 0 : h >= GEN_CHUNK_SIZE ? GEN_CHUNK_SIZE : (uint16_t) h;
+}
+
+static void gen_heights(gen_state_t *self) {
+	size_t count = height_index(HEIGHT_LEVELS, 0, 0);
+	self->height_min = malloc(sizeof(*self->height_min) * count);
+	self->height_max = malloc(sizeof(*self->height_max) * count);
+
+	for (uint32_t x = 0; x < GEN_CHUNK_SIZE; x++) {
+		for (uint32_t z = 0; z < GEN_CHUNK_SIZE; z++) {
+			size_t i = height_index(0, x, z);
+			self->height_min[i] = self->height_max[i] = gen_column_height(self, x, z);
+		}
+	}
+
+	uint8_t octaves = self->config->height_octaves ? self->config->height_octaves : 1;
+	self->stats->noise_evals += (size_t) GEN_CHUNK_SIZE * GEN_CHUNK_SIZE * octaves;
+
+	for (uint8_t level = 1; level < HEIGHT_LEVELS; level++) {
+		uint32_t size = 1 << level;
+		for (uint32_t x = 0; x < GEN_CHUNK_SIZE; x += size) {
+			for (uint32_t z = 0; z < GEN_CHUNK_SIZE; z += size) {
+				uint16_t min = UINT16_MAX, max = 0;
+				for (uint8_t i = 0; i < 4; i++) {
+					size_t child = height_index(level - 1, x + (i >> 1) * (size >> 1), z + (i & 1) * (size >> 1));
+					min = self->height_min[child] < min ? self->height_min[child] : min;
+					max = self->height_max[child] > max ? self->height_max[child] : max;
+				}
+				self->height_min[height_index(level, x, z)] = min;
+				self->height_max[height_index(level, x, z)] = max;
+			}
+		}
+	}
+}
+
+static voct_node_t *gen_column_node(gen_state_t *self, voxel_cache_t *cache,
+	uint32_t x, uint32_t y, uint32_t z, uint8_t depth) {
+	uint32_t size = 1 << depth;
+
+	if (x >= GEN_CHUNK_SIZE || y >= GEN_CHUNK_SIZE || z >= GEN_CHUNK_SIZE)
+		return NULL;
+
+	size_t i = height_index(depth, x, z);
+
+	/* every column under the node covers it */
+	if (y + size <= self->height_min[i]) {
+		self->stats->nodes_solid++;
+		self->stats->solid_count += (size_t) size * size * size;
+		return voxel_new(cache, x, y, z, depth);
+	}
+
+	/* no column reaches it */
+	if (y >= self->height_max[i]) {
+		self->stats->nodes_empty++;
+		return NULL;
+	}
+
+	/* a single column always falls into one of the above, so depth > 0 */
+	voct_node_t *node = voct_node_new(cache, depth);
+	uint32_t half = size >> 1;
+	for (uint8_t i = 0; i < 8; i++)
+		node->children[(i&4) >> 2][(i&2) >> 1][i&1] = gen_column_node(self, cache,
+			x + (i >> 2 & 1) * half, y + (i >> 1 & 1) * half, z + (i & 1) * half, depth - 1);
+
+	return node;
+}
+
+static void gen_tree_heightmap(gen_state_t *self, voxel_cache_t *cache, voct_node_t *root) {
+	uint32_t half = 1 << (root->depth - 1);
+
+	gen_heights(self);
+
+	for (uint8_t i = 0; i < 8; i++)
+		root->children[(i&4) >> 2][(i&2) >> 1][i&1] = gen_column_node(self, cache,
+			(i >> 2 & 1) * half, (i >> 1 & 1) * half, (i & 1) * half, root->depth - 1);
+
+	voxel_collapse(cache, root, 0, 0, 0);
+
+	free(self->height_min);
+	free(self->height_max);
+}
+
+static void gen_chunk_heightmap(gen_state_t *self) {
+	gen_heights(self);
+
+	for (uint32_t x = 0; x < GEN_CHUNK_SIZE; x++)
+		for (uint32_t z = 0; z < GEN_CHUNK_SIZE; z++)
+			for (uint32_t y = 0; y < self->height_min[height_index(0, x, z)]; y++)
+				voxel_occ_set(self->occ, x, y, z);
+
+	free(self->height_min);
+	free(self->height_max);
+}
+
+static bool gen_config_valid(gen_config_t const *config) {
+	uint32_t step = config->lattice_step;
+	uint32_t refine = config->refine_step;
+	return step && !(step & (step - 1)) && step <= GEN_CHUNK_SIZE &&
+		refine && !(refine & (refine - 1)) && refine <= step;
+}
+
+bool gen_config_check(gen_config_t const *config) {
+	if (config->mode == GEN_MODE_COARSE && !gen_config_valid(config)) {
+		fprintf(stderr, "warning: invalid coarse lattice %u/%u, sampling every voxel\n",
+			config->lattice_step, config->refine_step);
+		return false;
+	}
+
+	if (config->mode == GEN_MODE_HIERARCHICAL && config->fractal.octaves > 1) {
+		fprintf(stderr, "warning: cannot bound %d fractal octaves, sampling every voxel\n",
+			config->fractal.octaves);
+		return false;
+	}
+
+	return true;
+}
+
+void gen_chunk(gen_config_t const *config, struct osn_context const *noise, int32_t const origin[3],
+	uint64_t *occ, gen_stats_t *stats, task_pool_t *tasks) {
+	gen_state_t self = {
+		.config = config,
+		.noise = noise,
+		.origin = { origin[0], origin[1], origin[2] },
+		.occ = occ,
+		.stats = stats,
+		.scratch = malloc(sizeof(float) * LATTICE_SIZE * LATTICE_SIZE),
+		.tasks = tasks,
+	};
+
+	memset(occ, 0, sizeof(*occ) * VOXEL_OCC_WORDS);
+	memset(stats, 0, sizeof(*stats));
+
+	/* gen_config_check reports the fallback once, rather than every chunk */
+	if (config->mode == GEN_MODE_COARSE && !gen_config_valid(config)) {
+		gen_chunk_full(&self);
+	} else if (config->mode == GEN_MODE_COARSE) {
+		gen_chunk_coarse(&self);
+	} else if (config->mode == GEN_MODE_HEIGHTMAP) {
+		gen_chunk_heightmap(&self);
+	} else {
+		gen_chunk_full(&self);
+	}
+
+	for (size_t i = 0; i < VOXEL_OCC_WORDS; i++)
+		stats->solid_count += __builtin_popcountll(occ[i]);
+
+	free(self.scratch);
+}
+
+static voct_node_t *gen_node(gen_state_t *self, voxel_cache_t *cache,
+	uint32_t x, uint32_t y, uint32_t z, uint8_t depth);
+
+static void gen_octant_run(void *arg) {
+	gen_octant_t *octant = arg;
+	octant->node = gen_node(&octant->state, &octant->cache, octant->x, octant->y, octant->z, octant->depth);
+}
+
+/* builds the children of node as one task each. caches are not shared
+ * between threads, so every task allocates from its own and they are all
+ * moved into the chunk's once done
+ */
+static void gen_node_split(gen_state_t *self, voxel_cache_t *cache, voct_node_t *node,
+	uint32_t x, uint32_t y, uint32_t z) {
+	gen_octant_t octants[8];
+	task_group_t group = { 0 };
+	uint32_t half = 1 << (node->depth - 1);
+
+	for (uint8_t i = 0; i < 8; i++) {
+		octants[i].state = gen_state_fork(self, &octants[i].stats);
+		voxel_cache_new(&octants[i].cache);
+		octants[i].x = x + (i >> 2 & 1) * half;
+		octants[i].y = y + (i >> 1 & 1) * half;
+		octants[i].z = z + (i & 1) * half;
+		octants[i].depth = node->depth - 1;
+		task_spawn(self->tasks, &group, gen_octant_run, octants + i);
+	}
+
+	task_wait(self->tasks, &group);
+
+	for (uint8_t i = 0; i < 8; i++) {
+		node->children[(i&4) >> 2][(i&2) >> 1][i&1] = octants[i].node;
+		voxel_cache_adopt(cache, &octants[i].cache);
+		gen_stats_add(self->stats, &octants[i].stats);
+		free(octants[i].state.scratch);
+	}
+}
+
+/* classifies an octree child of the given depth covering [x, x + 2^depth)
+ * and fills it in, descending into it if it straddles the surface. with a
+ * task pool the chunk's node is split into a task per child
+ */
+static voct_node_t *gen_node(gen_state_t *self, voxel_cache_t *cache,
+	uint32_t x, uint32_t y, uint32_t z, uint8_t depth) {
+	uint32_t size = 1 << depth;
+
+	if (x >= GEN_CHUNK_SIZE || y >= GEN_CHUNK_SIZE || z >= GEN_CHUNK_SIZE)
+		return NULL;
+
+	/* bounds are taken over the voxel sample points, which are the low
+	 * corners of the voxels
+	 */
+	double lo, hi;
+	open_simplex_noise3_bounds(self->noise,
+		gen_coord(self, 0, x), gen_coord(self, 1, y), gen_coord(self, 2, z),
+		gen_coord(self, 0, x + size - 1), gen_coord(self, 1, y + size - 1), gen_coord(self, 2, z + size - 1),
+		&lo, &hi);
+	self->stats->bound_evals++;
+
+	/* leave room for float rounding in the sampled field */
+	if (lo > OSN_GRID_TOLERANCE) {
+		self->stats->nodes_solid++;
+		self->stats->solid_count += (size_t) size * size * size;
+		return voxel_new(cache, x, y, z, depth);
+	}
+
+	if (hi <= -OSN_GRID_TOLERANCE) {
+		self->stats->nodes_empty++;
+		return NULL;
+	}
+
+	voct_node_t *node = voct_node_new(cache, depth);
+
+	if (depth <= self->config->sample_depth) {
+		self->stats->nodes_sampled++;
+		for (uint32_t i = 0; i < size; i++) {
+			self->stats->noise_evals += gen_plane(self, x + i, y, z, 1, size, self->scratch, false);
+
+			for (uint32_t j = 0; j < size; j++)
+				for (uint32_t k = 0; k < size; k++)
+					if (self->scratch[j * size + k] > 0) {
+						voxel_set(cache, node, x + i, y + j, z + k);
+						self->stats->solid_count++;
+					}
+		}
+	} else if (self->tasks && size == GEN_CHUNK_SIZE) {
+		gen_node_split(self, cache, node, x, y, z);
+		voxel_collapse(cache, node, x, y, z);
+	} else {
+		uint32_t half = size >> 1;
+		for (uint8_t i = 0; i < 8; i++)
+			node->children[(i&4) >> 2][(i&2) >> 1][i&1] = gen_node(self, cache,
+				x + (i >> 2 & 1) * half, y + (i >> 1 & 1) * half, z + (i & 1) * half, depth - 1);
+		voxel_collapse(cache, node, x, y, z);
+	}
+
+	if (!node->is_leaf) {
+		bool empty = true;
+		for (uint8_t i = 0; empty && i < 8; i++)
+			empty = !node->children[(i&4) >> 2][(i&2) >> 1][i&1];
+
+		if (empty) {
+			voct_pool_release(&cache->pool, node);
+			return NULL;
+		}
+	}
+
+	return node;
+}
+
+static void gen_tree_hierarchical(gen_state_t *self, voxel_cache_t *cache, voct_node_t *root) {
+	uint32_t half = 1 << (root->depth - 1);
+
+	for (uint8_t i = 0; i < 8; i++)
+		root->children[(i&4) >> 2][(i&2) >> 1][i&1] = gen_node(self, cache,
+			(i >> 2 & 1) * half, (i >> 1 & 1) * half, (i & 1) * half, root->depth - 1);
+
+	voxel_collapse(cache, root, 0, 0, 0);
+}
+
+void gen_tree(gen_config_t const *config, struct osn_context const *noise, int32_t const origin[3],
+	voxel_cache_t *cache, voct_node_t *root, gen_stats_t *stats, task_pool_t *tasks) {
+	/* the noise bounds only hold for a single octave */
+	bool hierarchical = config->mode == GEN_MODE_HIERARCHICAL && config->fractal.octaves <= 1;
+
+	if (hierarchical || config->mode == GEN_MODE_HEIGHTMAP) {
+		gen_state_t self = {
+			.config = config,
+			.noise = noise,
+			.origin = { origin[0], origin[1], origin[2] },
+			.stats = stats,
+			.scratch = malloc(sizeof(float) * GEN_CHUNK_SIZE * GEN_CHUNK_SIZE),
+			.tasks = tasks,
+		};
+
+		memset(stats, 0, sizeof(*stats));
+		if (hierarchical)
+			gen_tree_hierarchical(&self, cache, root);
+		else
+			gen_tree_heightmap(&self, cache, root);
+		free(self.scratch);
+		return;
+	}
+
+	uint64_t *occ = malloc(sizeof(*occ) * VOXEL_OCC_WORDS);
+	gen_chunk(config, noise, origin, occ, stats, tasks);
+	voxel_build(cache, root, occ);
+	free(occ);
+}
+
+void gen_stats_print(gen_stats_t const *stats) {
+	fprintf(stderr, "noise_evals: %lu\n", stats->noise_evals);
+	fprintf(stderr, "solid_count: %lu\n", stats->solid_count);
+	if (stats->octaves_skipped)
+		fprintf(stderr, "octaves_skipped: %lu\n", stats->octaves_skipped);
+	if (stats->bound_evals)
+		fprintf(stderr, "bound_evals: %lu\n", stats->bound_evals);
+	if (stats->nodes_solid || stats->nodes_empty) {
+		fprintf(stderr, "nodes_solid: %lu\n", stats->nodes_solid);
+		fprintf(stderr, "nodes_empty: %lu\n", stats->nodes_empty);
+		fprintf(stderr, "nodes_sampled: %lu\n", stats->nodes_sampled);
+	}
+	if (stats->error_measured) {
+		fprintf(stderr, "sign_errors: %lu\n", stats->sign_errors);
+		fprintf(stderr, "max_error: %f\n", stats->max_error);
+		fprintf(stderr, "rms_error: %f\n", stats->rms_error);
+	}
+}
@@ -0,0 +1,144 @@
+#ifndef GEN_H__
+#define GEN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "simplex.h"
+#include "voct.h"
+#include "task.h"
+
+/* chunks are cubes of GEN_CHUNK_SIZE voxels a side, held as voct.h
+ * occupancy bitmaps
+ */
+#define GEN_CHUNK_SIZE VOXEL_OCC_SIZE
+
+/* noise frequency; one noise unit spans this many voxels */
+#define GEN_NOISE_SCALE 32.0f
+
+typedef enum gen_mode_t {
+	/* sample noise at every voxel */
+	GEN_MODE_FULL = 0,
+
+	/* sample noise on a coarse lattice and trilinearly interpolate between
+	 * lattice points, refining only cells where the density may change sign
+	 */
+	GEN_MODE_COARSE = 1,
+
+	/* build the octree top-down, bounding the noise over each node's box.
+	 * nodes proven solid become a single leaf and nodes proven empty stay
+	 * NULL without sampling; only nodes that straddle the surface are split,
+	 * and those at sample_depth or below are sampled voxel by voxel. this
+	 * only pays off on fields with large solid or empty regions. plain noise
+	 * at GEN_NOISE_SCALE has a surface in nearly every node above 8 voxels,
+	 * and inserting the sampled voxels one by one costs more than
+	 * GEN_MODE_FULL's single voxel_build: on the default terrain it is about
+	 * 2.5x slower than GEN_MODE_FULL and 7x slower than GEN_MODE_COARSE
+	 */
+	GEN_MODE_HIERARCHICAL = 2,
+
+	/* plain heightfield terrain: one 2D noise sample per (x, z) column,
+	 * solid below the column height. octree nodes are classified against
+	 * the lowest and highest column under them, so runs of columns go into
+	 * the tree as whole subtrees instead of voxel by voxel
+	 */
+	GEN_MODE_HEIGHTMAP = 3,
+} gen_mode_t;
+
+typedef struct gen_config_t {
+	gen_mode_t mode;
+
+	/* GEN_MODE_COARSE: spacing of the initial lattice in voxels, usually 4
+	 * or 8. cells whose corners straddle zero, or come within refine_margin
+	 * of it, are resampled with a spacing of refine_step. a refine_step of 1
+	 * samples every such voxel exactly; 2 or more interpolates those too,
+	 * trading a few surface voxels for far fewer noise evaluations. both
+	 * steps must be powers of two
+	 */
+	uint32_t lattice_step;
+	uint32_t refine_step;
+	float refine_margin;
+
+	/* also sample the full resolution field and compare against it */
+	bool measure_error;
+
+	/* GEN_MODE_HIERARCHICAL: depth at which straddling nodes stop being
+	 * bounded and are sampled voxel by voxel instead
+	 */
+	uint8_t sample_depth;
+
+	/* GEN_MODE_HEIGHTMAP: column height in voxels is height_base plus
+	 * height_amplitude times the 2D noise, summed over height_octaves
+	 * octaves of doubling frequency and halving amplitude
+	 */
+	float height_base;
+	float height_amplitude;
+	uint8_t height_octaves;
+
+	/* 3D modes: with more than one octave the density is this fractal sum
+	 * rather than plain noise. its threshold and early_exit are ignored;
+	 * solid is always above zero, and octaves are cut short wherever the
+	 * values are not interpolated: every voxel of GEN_MODE_FULL and, at a
+	 * refine_step of 1, the refined voxels of GEN_MODE_COARSE. its lattice
+	 * and coarser refinement take every octave, and so does measure_error.
+	 * GEN_MODE_HIERARCHICAL cannot bound a fractal and samples every voxel
+	 * instead
+	 */
+	struct osn_fractal fractal;
+} gen_config_t;
+
+typedef struct gen_stats_t {
+	size_t noise_evals;
+	size_t solid_count;
+	size_t octaves_skipped;
+
+	/* GEN_MODE_HIERARCHICAL */
+	size_t bound_evals;
+	size_t nodes_solid;
+	size_t nodes_empty;
+	size_t nodes_sampled;
+
+	/* only filled in when measure_error is set */
+	bool error_measured;
+	size_t sign_errors;
+	float max_error;
+	float rms_error;
+} gen_stats_t;
+
+/* returns the noise context for seed, building it on first use. contexts
+ * are shared read-only between every caller and owned by the registry;
+ * they stay valid until gen_noise_release
+ */
+struct osn_context const *gen_noise_get(int64_t seed);
+
+/* frees every registered context. no generation may be in flight */
+void gen_noise_release(void);
+
+/* warns about any part of config that generation can not honour, and returns
+ * false if there is one. generation then falls back to sampling every voxel
+ * without a word, so callers check a config once before using it
+ */
+bool gen_config_check(gen_config_t const *config);
+
+/* fills occ (VOXEL_OCC_WORDS words) with the solid voxels of one chunk,
+ * whose low corner sits at origin in world voxels.
+ * GEN_MODE_HIERARCHICAL only makes sense for trees and samples every voxel.
+ * with a task pool, GEN_MODE_FULL and GEN_MODE_COARSE are split into slabs
+ * run as tasks; GEN_MODE_HEIGHTMAP runs on the calling thread. tasks may be
+ * NULL
+ */
+void gen_chunk(gen_config_t const *config, struct osn_context const *noise, int32_t const origin[3],
+	uint64_t *occ, gen_stats_t *stats, task_pool_t *tasks);
+
+/* generates the chunk at origin straight into an octree. root must be an
+ * empty interior node deep enough to hold GEN_CHUNK_SIZE voxels a side.
+ * with a task pool GEN_MODE_HIERARCHICAL builds each child of the chunk's
+ * node as a task. tasks may be NULL
+ */
+void gen_tree(gen_config_t const *config, struct osn_context const *noise, int32_t const origin[3],
+	voxel_cache_t *cache, voct_node_t *root, gen_stats_t *stats, task_pool_t *tasks);
+
+void gen_stats_print(gen_stats_t const *stats);
+
+#endif
@@ -0,0 +1,204 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "voct.h"
+#include "gen.h"
+#include "task.h"
+#include "chunk.h"
+
+/* generates chunks the way the app does, through visibility, greedy merging
+ * and extraction, with no window or GL context, and reports where the time
+ * and memory went. chunks fill a cube around the world origin
+ */
+
+typedef struct headless_chunk_t {
+	chunk_t chunk;
+	gen_config_t const *config;
+	int64_t seed;
+	int32_t x, y, z;
+	task_pool_t *tasks;
+} headless_chunk_t;
+
+static char const *const headless_mode_names[] = {
+	[GEN_MODE_FULL] = "full",
+	[GEN_MODE_COARSE] = "coarse",
+	[GEN_MODE_HIERARCHICAL] = "hierarchical",
+	[GEN_MODE_HEIGHTMAP] = "heightmap",
+};
+
+static double headless_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void headless_chunk_run(void *arg) {
+	headless_chunk_t *self = arg;
+	chunk_gen(&self->chunk, self->config, self->seed, self->x, self->y, self->z, self->tasks);
+}
+
+static void usage(char const *name) {
+	fprintf(stderr, "usage: %s [-n chunks] [-t threads] [-s seed] [-m full|coarse|hierarchical|heightmap] [-e]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	gen_config_t config = {
+		.mode = GEN_MODE_COARSE,
+		.lattice_step = 8,
+		/* the app's lossy default; -e reports the sign errors it costs */
+		.refine_step = 4,
+		.refine_margin = 0.02f,
+		.sample_depth = 2,
+		.height_base = 64.0f,
+		.height_amplitude = 32.0f,
+		.height_octaves = 4,
+		.fractal = { .type = OSN_FRACTAL_FBM, .octaves = 1, .lacunarity = 2.0, .gain = 0.5 },
+	};
+	uint32_t count = 8;
+	uint32_t workers = 0;
+	int64_t seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:t:s:m:e")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			workers = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			seed = strtoll(optarg, NULL, 10);
+			break;
+		case 'm': {
+			size_t mode = 0;
+			while (mode < sizeof(headless_mode_names) / sizeof(*headless_mode_names) &&
+				strcmp(optarg, headless_mode_names[mode]))
+				mode++;
+			if (mode == sizeof(headless_mode_names) / sizeof(*headless_mode_names))
+				usage(argv[0]);
+			config.mode = mode;
+			break;
+		}
+		case 'e':
+			config.measure_error = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!count)
+		usage(argv[0]);
+
+	gen_config_check(&config);
+
+	headless_chunk_t *chunks = calloc(count, sizeof(*chunks));
+	if (!chunks) {
+		fprintf(stderr, "error: out of memory allocating chunks\n");
+		exit(1);
+	}
+
+	task_pool_t tasks;
+	task_pool_new(&tasks, workers);
+
+	/* the smallest cube of chunks holding count, centred on the origin */
+	uint32_t side = 1;
+	while ((uint64_t) side * side * side < count)
+		side++;
+	int32_t low = -(int32_t) (side / 2);
+
+	task_group_t group = { 0 };
+	double start = headless_now();
+
+	for (uint32_t i = 0; i < count; i++) {
+		chunks[i] = (headless_chunk_t){
+			.config = &config,
+			.seed = seed,
+			.x = low + i % side,
+			.y = low + i / (side * side),
+			.z = low + i / side % side,
+			.tasks = &tasks,
+		};
+		task_spawn(&tasks, &group, headless_chunk_run, chunks + i);
+	}
+
+	task_wait(&tasks, &group);
+	double seconds = headless_now() - start;
+
+	chunk_timing_t timing = { 0 };
+	gen_stats_t stats = { 0 };
+	size_t instances = 0, merged = 0, tree_bytes = 0, draw_bytes = 0, nodes = 0;
+	double error_sq = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		chunk_t const *chunk = &chunks[i].chunk;
+		timing.gen += chunk->timing.gen;
+		timing.visible += chunk->timing.visible;
+		timing.greedy += chunk->timing.greedy;
+		timing.emit += chunk->timing.emit;
+		stats.noise_evals += chunk->stats.noise_evals;
+		stats.solid_count += chunk->stats.solid_count;
+		stats.error_measured |= chunk->stats.error_measured;
+		stats.sign_errors += chunk->stats.sign_errors;
+		stats.max_error = chunk->stats.max_error > stats.max_error ? chunk->stats.max_error : stats.max_error;
+		/* chunks are the same size, so the mean square is the mean of theirs */
+		error_sq += (double) chunk->stats.rms_error * chunk->stats.rms_error / count;
+		instances += chunk->to_draw_count;
+		merged += chunk->merged;
+		nodes += chunk->cache.pool.live;
+		tree_bytes += voxel_cache_bytes(&chunk->cache);
+		draw_bytes += sizeof(*chunk->to_draw) * chunk->to_draw_count;
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("chunks: %u\n", count);
+	printf("mode: %s\n", headless_mode_names[config.mode]);
+	printf("workers: %u\n", tasks.worker_count);
+	printf("seconds: %.6f\n", seconds);
+	printf("chunks_per_second: %.2f\n", count / seconds);
+	/* stage times are each chunk's wall clock, summed. chunks run side by
+	 * side on the workers, so they overlap and add up to more than seconds
+	 */
+	printf("gen_seconds: %.6f\n", timing.gen);
+	printf("visible_seconds: %.6f\n", timing.visible);
+	printf("greedy_seconds: %.6f\n", timing.greedy);
+	printf("emit_seconds: %.6f\n", timing.emit);
+	printf("noise_evals: %zu\n", stats.noise_evals);
+	printf("solid_count: %zu\n", stats.solid_count);
+	/* only GEN_MODE_COARSE measures its error */
+	if (stats.error_measured) {
+		printf("sign_errors: %zu\n", stats.sign_errors);
+		printf("max_error: %f\n", stats.max_error);
+		printf("rms_error: %f\n", sqrt(error_sq));
+	}
+	printf("instances: %zu\n", instances);
+	printf("merged: %zu\n", merged);
+	printf("nodes: %zu\n", nodes);
+	printf("tree_bytes: %zu\n", tree_bytes);
+	printf("draw_bytes: %zu\n", draw_bytes);
+	/* kilobytes on linux */
+	printf("max_rss_kb: %ld\n", usage.ru_maxrss);
+
+	for (uint32_t i = 0; i < count; i++)
+		chunk_free(&chunks[i].chunk);
+	free(chunks);
+
+	task_pool_free(&tasks);
+	gen_noise_release();
+	return 0;
+}
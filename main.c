@@ -4,9 +4,11 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <pthread.h>
+#include <math.h>
 
 #include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
@@ -14,158 +16,201 @@
 
 #include "simplex.h"
 #include "voct.h"
-
-#define MAX_TO_DRAW (128*128*64)
-
-typedef struct chunk_t {
-	voxel_cache_t cache;
-	voct_node_t tree;
-	voxel_t to_draw[MAX_TO_DRAW];
-	size_t to_draw_count;
-	unsigned int cube_ebo;
-	unsigned int cube_vbo;
+#include "gen.h"
+#include "task.h"
+#include "chunk.h"
+
+/* chunks load within VIEW_RADIUS chunks of the camera's chunk and unload
+ * beyond VIEW_KEEP, so a camera sitting on a chunk border does not make
+ * chunks come and go
+ */
+#define VIEW_RADIUS 2
+#define VIEW_KEEP (VIEW_RADIUS + 1)
+
+/* chunks handed to the task pool at once per worker. the rest wait in the
+ * app's queue, where they can still be reordered or dropped
+ */
+#define CHUNKS_IN_FLIGHT 2
+
+/* finished chunks uploaded per frame at most, so a burst of them does not
+ * stall a frame
+ */
+#define CHUNKS_PER_FRAME 4
+
+typedef enum chunk_state_t {
+	/* waiting in the app's queue */
+	CHUNK_QUEUED,
+	/* handed to the task pool */
+	CHUNK_PENDING,
+	CHUNK_GENERATING,
+	/* generated and on the app's finished queue, waiting for upload on the
+	 * GL thread
+	 */
+	CHUNK_READY,
+	CHUNK_LOADED,
+	/* dropped before its task started. the task marks it dead and queues
+	 * it as finished all the same
+	 */
+	CHUNK_CANCELLED,
+	CHUNK_DEAD,
+} chunk_state_t;
+
+/* a chunk as the app streams and draws it */
+typedef struct app_chunk_t {
+	/* chunk coordinates */
+	int32_t pos[3];
+	/* squared distance in chunks from the camera's chunk */
+	int32_t distance;
+	/* a chunk_state_t. the app and the chunk's task hand it over through
+	 * this and touch nothing else of each other's
+	 */
+	atomic_int state;
+	task_pool_t *tasks;
+	task_queue_t *finished;
+
+	chunk_t chunk;
 	unsigned int vao;
 	unsigned int off_vbo;
+	/* the chunk's face groups within off_vbo, kept past releasing its
+	 * instances
+	 */
+	size_t face_first[VOXEL_FACE_COUNT];
+	size_t face_count[VOXEL_FACE_COUNT];
 	size_t lod;
-} chunk_t;
+} app_chunk_t;
 
 typedef struct app_t {
 	GLFWwindow *window;
-	size_t cube_count;
-	chunk_t chunks[8][8][8];
-} app_t;
-
-typedef struct chunk_thread_t {
-	chunk_t *chunk;
-	int32_t x, y, z;
-} chunk_thread_t;
-
-void chunk_gen(chunk_t *self, int32_t x, int32_t y, int32_t z) {
-	voxel_cache_new(&self->cache);
-	self->tree.depth = 8;
-	self->tree.is_leaf = false;
-	memset(self->tree.children, 0, sizeof(self->tree.children));
-
-	struct osn_context *simplex;
-	open_simplex_noise(1, &simplex);
-
-	size_t voxel_count = 0;
-
-	for (int32_t i = 0; i < 128; i++) {
-		for (int32_t j = 0; j < 128; j++) {
-			for (int32_t k = 0; k < 128; k++) {
-				int32_t off_x = i;
-				int32_t off_y = j;
-				int32_t off_z = k;
-				if (open_simplex_noise3(simplex, off_x / 32.0f, off_y / 32.0f, off_z / 32.0f) > 0)
-					voxel_set(&self->cache, &self->tree, &self->tree, off_x, off_y, off_z), voxel_count++;
-			}
-		}
-	}
-
-	// voxel_set_visible(&self->tree, &self->tree);
-
-	// voxel_greedy(&self->tree);
-
-	for (size_t i = 0; i < VOXEL_CACHE_SIZE && self->to_draw_count < MAX_TO_DRAW; i++) {
-		block_flags_t flags = self->cache.ptr[i].scale & 0xff;
-		if (flags & BLOCK_FLAG_EXISTS && !(flags & BLOCK_FLAG_HIDDEN)) {
-			self->to_draw[self->to_draw_count] = self->cache.ptr[i];
-			self->to_draw_count++;
-		}
-	}
 
-	// dump_tree(&self->tree);
-
-	fprintf(stderr, "voxel_count: %lu\n", voxel_count);
-	fprintf(stderr, "to_draw_count: %lu\n", self->to_draw_count);
-	fprintf(stderr, "ring_pos: %lu\n", self->cache.ring_index);
-
-	self->lod = 0;
-}
+	task_pool_t tasks;
+	task_group_t chunk_tasks;
+	/* chunks handed to the pool and not yet taken off finished. finished
+	 * holds at least this many, so tasks can always push
+	 */
+	size_t in_flight;
+	task_queue_t finished;
+	/* chunks handed off by app_update. task_spawn takes the pool's locks,
+	 * so the frame loop only pushes here and posts requested, and feeder
+	 * spawns them from a thread of its own
+	 */
+	task_queue_t requests;
+	sem_t requested;
+	pthread_t feeder;
+
+	/* every chunk in range, plus those out of range waiting on their task.
+	 * there are only ever a few hundred, so lookups just scan
+	 */
+	app_chunk_t **chunks;
+	size_t chunk_count;
+	size_t chunk_capacity;
+
+	/* binary heap of the queued chunks, nearest first */
+	app_chunk_t **queue;
+	size_t queue_count;
+	size_t queue_capacity;
+
+	int32_t center[3];
+	bool centered;
+} app_t;
 
-void chunk_load(chunk_t *self) {
+/* every chunk samples the same noise, so they join up into one world */
+#define WORLD_SEED 1
+
+static gen_config_t const gen_config = {
+	.mode = GEN_MODE_COARSE,
+	.lattice_step = 8,
+	/* lossy: against sampling every voxel, about 6.6K surface voxels per
+	 * chunk land on the wrong side, 1.6K at a refine_step of 2 and none at
+	 * 1. but 1 takes 25 times the noise evaluations, 77% of GEN_MODE_FULL's,
+	 * and most of the gain over it is gone. bench's coarse table has the
+	 * numbers
+	 */
+	.refine_step = 4,
+	.refine_margin = 0.02f,
+	.measure_error = false,
+	.sample_depth = 2,
+	.height_base = 64.0f,
+	.height_amplitude = 32.0f,
+	.height_octaves = 4,
+	.fractal = {
+		.type = OSN_FRACTAL_FBM,
+		.octaves = 1,
+		.lacunarity = 2.0,
+		.gain = 0.5,
+	},
+};
+
+void app_chunk_load(app_chunk_t *self) {
 	glGenVertexArrays(1, &self->vao);
 	glBindVertexArray(self->vao);
 
-	unsigned int buffers[3] = { 0 };
-	glGenBuffers(3, buffers);
-
-	self->cube_ebo = buffers[0];
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->cube_ebo);
-
-	static const unsigned int elements[] = {
-		3, 2, 6, 7, 4, 2, 0,
-		3, 1, 6, 5, 4, 1, 0
-	};
-
-	glNamedBufferData(self->cube_ebo, sizeof(elements), elements, GL_STATIC_DRAW);
-
-	self->cube_vbo = buffers[1];
-	glBindBuffer(GL_ARRAY_BUFFER, self->cube_vbo);
-
-	static const float cube_data[] = {
-		1.0, 1.0, 1.0,
-		0.0, 1.0, 1.0,
-		1.0, 1.0, 0.0,
-		0.0, 1.0, 0.0,
-		1.0, 0.0, 1.0,
-		0.0, 0.0, 1.0,
-		0.0, 0.0, 0.0,
-		1.0, 0.0, 0.0
-	};
-
-	glNamedBufferData(self->cube_vbo, sizeof(cube_data), cube_data, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), NULL);
-	glEnableVertexAttribArray(0);
-
-	self->off_vbo = buffers[2];
+	glGenBuffers(1, &self->off_vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, self->off_vbo);
-	glNamedBufferData(self->off_vbo, sizeof(voxel_t) * self->to_draw_count, self->to_draw, GL_STATIC_DRAW);
-	//glNamedBufferData(self->off_vbo, sizeof(voxel_t) * VOXEL_CACHE_SIZE, self->cache.ptr, GL_STATIC_DRAW);
-
-	glVertexAttribIPointer(1, 4, GL_INT, sizeof(voxel_t), NULL);
+	glNamedBufferData(self->off_vbo, sizeof(*self->chunk.to_draw) * self->chunk.to_draw_count, self->chunk.to_draw,
+		GL_STATIC_DRAW);
+
+	/* the buffer holds its own copy */
+	memcpy(self->face_first, self->chunk.face_first, sizeof(self->face_first));
+	memcpy(self->face_count, self->chunk.face_count, sizeof(self->face_count));
+	chunk_release_draw(&self->chunk);
+
+	/* the quad corners come from gl_VertexID, so the instances are the only
+	 * vertex input. app_chunk_draw points binding 1 at each face group in
+	 * turn
+	 */
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(voxel_packed_t), NULL);
 	glVertexAttribDivisor(1, 1);
 	glEnableVertexAttribArray(1);
 }
 
-void *chunk_thread(void *ptr) {
-	chunk_thread_t *thread_info = (chunk_thread_t *) ptr;
-	fprintf(stderr, "generating %d %d %d\n", thread_info->x, thread_info->y, thread_info->z);
-	chunk_gen(thread_info->chunk, thread_info->x, thread_info->y, thread_info->z);
-	pthread_exit(NULL);
+void app_chunk_unload(app_chunk_t *self) {
+	glDeleteBuffers(1, &self->off_vbo);
+	glDeleteVertexArrays(1, &self->vao);
 }
 
-void chunk_set_lod(chunk_t *self, size_t lod) {
-	glBindVertexArray(self->vao);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->cube_ebo);
-	glBindBuffer(GL_ARRAY_BUFFER, self->cube_vbo);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), NULL);
-	glEnableVertexAttribArray(0);
+void app_chunk_task(void *ptr) {
+	app_chunk_t *self = (app_chunk_t *) ptr;
+	int expected = CHUNK_PENDING;
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->off_vbo);
+	if (atomic_compare_exchange_strong(&self->state, &expected, CHUNK_GENERATING)) {
+		chunk_gen(&self->chunk, &gen_config, WORLD_SEED, self->pos[0], self->pos[1], self->pos[2], self->tasks);
+		self->lod = 0;
+		atomic_store(&self->state, CHUNK_READY);
+	} else {
+		atomic_store(&self->state, CHUNK_DEAD);
+	}
 
-	glVertexAttribIPointer(1, 4, GL_INT, (4 * sizeof(int32_t)) << lod, NULL);
-	glVertexAttribDivisor(1, 1);
-	glEnableVertexAttribArray(1);
+	/* the app owns the chunk again from here */
+	if (!task_queue_push(self->finished, self)) {
+		fprintf(stderr, "error: finished chunk queue overflowed\n");
+		exit(1);
+	}
+}
 
+/* draws every 2^lod th instance of each face group */
+void app_chunk_set_lod(app_chunk_t *self, size_t lod) {
 	self->lod = lod;
 }
 
-void chunk_draw(chunk_t const *self) {
+void app_chunk_draw(app_chunk_t const *self) {
 	glBindVertexArray(self->vao);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->cube_ebo);
+	glUniform3iv(1, 1, self->chunk.origin);
+
+	for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++) {
+		size_t count = self->face_count[face] >> self->lod;
+		if (!count)
+			continue;
 
-	glDrawElementsInstanced(GL_TRIANGLE_STRIP, 14, GL_UNSIGNED_INT, NULL, self->to_draw_count);
-	//glDrawElementsInstanced(GL_TRIANGLE_STRIP, 14, GL_UNSIGNED_INT, NULL, 64 * 64 * 64);
+		glVertexArrayVertexBuffer(self->vao, 1, self->off_vbo,
+			sizeof(voxel_packed_t) * self->face_first[face], sizeof(voxel_packed_t) << self->lod);
+		glUniform1ui(2, face);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+	}
 }
 
 char const *vs_src = ""
 "#version 460 core\n"
-"layout (location = 0) in vec3 in_pos;"
-"layout (location = 1) in ivec4 offset;"
+"layout (location = 1) in uint voxel;"
 "layout (location = 0) out vec4 out_col;"
 "mat4 p = mat4("
 	"1.42814, 0, 0, 0,"
@@ -174,12 +219,24 @@ char const *vs_src = ""
 	"0, 0, -0.2, 0"
 ");"
 "layout (location = 0) uniform mat4 v;"
+"layout (location = 1) uniform ivec3 origin;"
+"layout (location = 2) uniform uint face;"
 "void main() {"
-	"uvec3 scale;"
-	"scale.x = 1 << (offset.w >> 24 & 0xff);"
-	"scale.y = 1 << (offset.w >> 16 & 0xff);"
-	"scale.z = 1 << (offset.w >>  8 & 0xff);"
-	"gl_Position =  p * v * vec4((in_pos * scale + offset.xyz) * vec3(0.1), 1.0);"
+	/* the quad spans the two other axes in the order that winds it
+	 * counter clockwise seen from outside the voxel
+	 */
+	"uint axis = face >> 1;"
+	"uint side = face & 1u;"
+	"vec2 uv = vec2(gl_VertexID & 1, gl_VertexID >> 1);"
+	"if (side == 0u) uv = uv.yx;"
+	"vec3 in_pos;"
+	"in_pos[axis] = float(side);"
+	"in_pos[(axis + 1u) % 3u] = uv.x;"
+	"in_pos[(axis + 2u) % 3u] = uv.y;"
+	"uvec3 pos = uvec3(voxel, voxel >> 7, voxel >> 14) & 0x7fu;"
+	"uvec3 scale = uvec3(1u) << (uvec3(voxel >> 21, voxel >> 24, voxel >> 27) & 7u);"
+	"vec3 offset = vec3(ivec3(pos) + origin);"
+	"gl_Position =  p * v * vec4((in_pos * vec3(scale) + offset) * vec3(0.1), 1.0);"
 	"out_col = vec4(in_pos, 0.0);"
 "}";
 
@@ -200,6 +257,260 @@ void debug_callback(
 	fprintf(stderr, "opengl: %s\n", msg);
 }
 
+static void *app_grow(void *ptr, size_t *capacity, size_t elem) {
+	size_t next = *capacity ? *capacity * 2 : 64;
+	void *ret = realloc(ptr, next * elem);
+	if (!ret) {
+		fprintf(stderr, "error: out of memory growing chunk list\n");
+		exit(1);
+	}
+	*capacity = next;
+	return ret;
+}
+
+static void app_queue_sift_down(app_t *self, size_t i) {
+	for (;;) {
+		size_t nearest = i;
+		for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < self->queue_count; child++)
+			if (self->queue[child]->distance < self->queue[nearest]->distance)
+				nearest = child;
+
+		if (nearest == i)
+			return;
+
+		app_chunk_t *swap = self->queue[i];
+		self->queue[i] = self->queue[nearest];
+		self->queue[nearest] = swap;
+		i = nearest;
+	}
+}
+
+static void app_queue_push(app_t *self, app_chunk_t *chunk) {
+	if (self->queue_count == self->queue_capacity)
+		self->queue = app_grow(self->queue, &self->queue_capacity, sizeof(*self->queue));
+
+	size_t i = self->queue_count++;
+	while (i && self->queue[(i - 1) / 2]->distance > chunk->distance) {
+		self->queue[i] = self->queue[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	self->queue[i] = chunk;
+}
+
+static app_chunk_t *app_queue_pop(app_t *self) {
+	app_chunk_t *ret = self->queue[0];
+	self->queue[0] = self->queue[--self->queue_count];
+	app_queue_sift_down(self, 0);
+	return ret;
+}
+
+static app_chunk_t *app_find(app_t const *self, int32_t const pos[3]) {
+	for (size_t i = 0; i < self->chunk_count; i++)
+		if (!memcmp(self->chunks[i]->pos, pos, sizeof(self->chunks[i]->pos)))
+			return self->chunks[i];
+	return NULL;
+}
+
+static void app_destroy(app_chunk_t *chunk) {
+	chunk_free(&chunk->chunk);
+	free(chunk);
+}
+
+/* lets go of a chunk out of range. returns false if its task still holds
+ * it, in which case app_update frees it once it comes off finished
+ */
+static bool app_drop(app_chunk_t *chunk) {
+	int state = atomic_load(&chunk->state);
+
+	if (state == CHUNK_PENDING) {
+		atomic_compare_exchange_strong(&chunk->state, &state, CHUNK_CANCELLED);
+		return false;
+	}
+
+	if (state != CHUNK_QUEUED && state != CHUNK_LOADED)
+		return false;
+
+	if (state == CHUNK_LOADED)
+		app_chunk_unload(chunk);
+	app_destroy(chunk);
+	return true;
+}
+
+/* recentres the world on the camera's chunk: drops chunks out of range,
+ * requests the missing ones and requeues everything by its new distance.
+ * stale queued chunks never reach the pool, and those already handed to
+ * it are cancelled if their task has not started
+ */
+static void app_stream(app_t *self, int32_t const center[3]) {
+	size_t kept = 0;
+
+	for (size_t i = 0; i < self->chunk_count; i++) {
+		app_chunk_t *chunk = self->chunks[i];
+		int32_t d[3] = { chunk->pos[0] - center[0], chunk->pos[1] - center[1], chunk->pos[2] - center[2] };
+		chunk->distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+		if (chunk->distance > VIEW_KEEP * VIEW_KEEP && app_drop(chunk))
+			continue;
+		self->chunks[kept++] = chunk;
+	}
+	self->chunk_count = kept;
+
+	for (int32_t i = -VIEW_RADIUS; i <= VIEW_RADIUS; i++) {
+		for (int32_t j = -VIEW_RADIUS; j <= VIEW_RADIUS; j++) {
+			for (int32_t k = -VIEW_RADIUS; k <= VIEW_RADIUS; k++) {
+				int32_t pos[3] = { center[0] + i, center[1] + j, center[2] + k };
+				if (i * i + j * j + k * k > VIEW_RADIUS * VIEW_RADIUS || app_find(self, pos))
+					continue;
+
+				app_chunk_t *chunk = calloc(1, sizeof(*chunk));
+				if (!chunk) {
+					fprintf(stderr, "error: out of memory allocating chunk\n");
+					exit(1);
+				}
+				memcpy(chunk->pos, pos, sizeof(pos));
+				chunk->distance = i * i + j * j + k * k;
+				atomic_init(&chunk->state, CHUNK_QUEUED);
+
+				if (self->chunk_count == self->chunk_capacity)
+					self->chunks = app_grow(self->chunks, &self->chunk_capacity, sizeof(*self->chunks));
+				self->chunks[self->chunk_count++] = chunk;
+			}
+		}
+	}
+
+	/* distances all changed, so the heap is rebuilt rather than fixed up */
+	self->queue_count = 0;
+	for (size_t i = 0; i < self->chunk_count; i++)
+		if (atomic_load(&self->chunks[i]->state) == CHUNK_QUEUED)
+			app_queue_push(self, self->chunks[i]);
+
+	memcpy(self->center, center, sizeof(self->center));
+	self->centered = true;
+}
+
+static void app_forget(app_t *self, app_chunk_t *chunk) {
+	for (size_t i = 0; i < self->chunk_count; i++) {
+		if (self->chunks[i] == chunk) {
+			self->chunks[i] = self->chunks[--self->chunk_count];
+			return;
+		}
+	}
+}
+
+/* spawns every chunk app_update requests, until it is handed NULL */
+static void *app_feed(void *arg) {
+	app_t *self = arg;
+	void *item;
+
+	for (;;) {
+		while (sem_wait(&self->requested));
+
+		/* each post follows its push, so there is always an item */
+		task_queue_pop(&self->requests, &item);
+		if (!item)
+			return NULL;
+		task_spawn(&self->tasks, &self->chunk_tasks, app_chunk_task, item);
+	}
+}
+
+/* uploads up to CHUNKS_PER_FRAME finished chunks, frees those no longer
+ * wanted and keeps the pool fed from the front of the queue. nothing here
+ * waits on the workers or takes a lock; chunks come and go through
+ * lock-free queues
+ */
+static void app_update(app_t *self) {
+	void *item;
+
+	for (uint32_t uploaded = 0; uploaded < CHUNKS_PER_FRAME && task_queue_pop(&self->finished, &item);) {
+		app_chunk_t *chunk = item;
+		int state = atomic_load(&chunk->state);
+		self->in_flight--;
+
+		/* a cancelled chunk only goes round again if the camera came back
+		 * within VIEW_RADIUS; short of that nothing would ever request it,
+		 * and app_stream makes it afresh once something does
+		 */
+		if (chunk->distance > VIEW_KEEP * VIEW_KEEP ||
+			(state != CHUNK_READY && chunk->distance > VIEW_RADIUS * VIEW_RADIUS)) {
+			app_forget(self, chunk);
+			app_destroy(chunk);
+			continue;
+		}
+
+		if (state == CHUNK_READY) {
+			app_chunk_load(chunk);
+			atomic_store(&chunk->state, CHUNK_LOADED);
+			uploaded++;
+		} else {
+			atomic_store(&chunk->state, CHUNK_QUEUED);
+			app_queue_push(self, chunk);
+		}
+	}
+
+	while (self->queue_count && self->in_flight < self->tasks.worker_count * CHUNKS_IN_FLIGHT) {
+		app_chunk_t *chunk = app_queue_pop(self);
+		chunk->tasks = &self->tasks;
+		chunk->finished = &self->finished;
+		atomic_store(&chunk->state, CHUNK_PENDING);
+		self->in_flight++;
+
+		/* requests holds in_flight and more, so this can not fail */
+		task_queue_push(&self->requests, chunk);
+		sem_post(&self->requested);
+	}
+}
+
+/* cancels what has not started, waits out the rest and frees every chunk */
+static void app_clear(app_t *self) {
+	for (size_t i = 0; i < self->chunk_count; i++) {
+		int state = CHUNK_PENDING;
+		atomic_compare_exchange_strong(&self->chunks[i]->state, &state, CHUNK_CANCELLED);
+	}
+
+	/* the feeder spawns everything requested before it gets to NULL, so
+	 * once it is joined the wait covers every chunk task
+	 */
+	task_queue_push(&self->requests, NULL);
+	sem_post(&self->requested);
+	pthread_join(self->feeder, NULL);
+
+	task_wait(&self->tasks, &self->chunk_tasks);
+
+	/* every chunk is still listed, so what is left on finished can go */
+	void *item;
+	while (task_queue_pop(&self->finished, &item));
+
+	for (size_t i = 0; i < self->chunk_count; i++) {
+		if (atomic_load(&self->chunks[i]->state) == CHUNK_LOADED)
+			app_chunk_unload(self->chunks[i]);
+		app_destroy(self->chunks[i]);
+	}
+
+	free(self->chunks);
+	free(self->queue);
+	self->chunks = NULL;
+	self->queue = NULL;
+	self->chunk_count = self->queue_count = self->in_flight = 0;
+	task_queue_free(&self->finished);
+	task_queue_free(&self->requests);
+	sem_destroy(&self->requested);
+}
+
+/* chunks are generated on a worker per core in the background, and split
+ * further inside gen_tree. app_loop requests them as the camera moves
+ */
+static void app_setup_tasks(app_t *self) {
+	task_pool_new(&self->tasks, 0);
+	task_queue_new(&self->finished, self->tasks.worker_count * CHUNKS_IN_FLIGHT);
+	/* one more for the NULL that stops the feeder */
+	task_queue_new(&self->requests, self->tasks.worker_count * CHUNKS_IN_FLIGHT + 1);
+
+	if (sem_init(&self->requested, 0, 0) || pthread_create(&self->feeder, NULL, app_feed, self)) {
+		fprintf(stderr, "error: failed to start the chunk feeder\n");
+		exit(1);
+	}
+}
+
 void app_setup(app_t *self) {
 	if (!glfwInit()) {
 		fprintf(stderr, "glfw: init failed\n");
@@ -227,27 +538,8 @@ void app_setup(app_t *self) {
 
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	pthread_t threads[8][8][8];
-	chunk_thread_t thread_infos[8][8][8];
-
-	for (int32_t i = 0; i < 1; i++)
-		for(int32_t j = 0; j < 1; j++)
-			for(int32_t k = 0; k < 1; k++) {
-		thread_infos[i][j][k] = (chunk_thread_t){
-			.chunk = self->chunks[i][j]+k,
-			.x = i,
-			.y = j,
-			.z = k
-		};
-		pthread_create(threads[i][j]+k, NULL, chunk_thread, thread_infos[i][j]+k);
-	}
-
-	for (int32_t i = 0; i < 1; i++)
-		for(int32_t j = 0; j < 1; j++)
-			for(int32_t k = 0; k < 1; k++) {
-		pthread_join(threads[i][j][k], NULL);
-		chunk_load(self->chunks[i][j]+k);
-	}
+	gen_config_check(&gen_config);
+	app_setup_tasks(self);
 
 	unsigned int vs = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vs, 1, &vs_src, NULL);
@@ -276,13 +568,22 @@ bool app_loop(app_t *self) {
 		0.0, 0.0, 0.0, 1.0
 	};
 
+	/* the view scales by 0.1 on top of the 0.1 vs_src applies, so the
+	 * camera sits at minus 100 times the translation, in voxels
+	 */
+	int32_t center[3];
+	for (uint8_t i = 0; i < 3; i++)
+		center[i] = (int32_t) floorf(-100.0f * v_mat[4 * i + 3] / GEN_CHUNK_SIZE);
+
+	if (!self->centered || memcmp(center, self->center, sizeof(center)))
+		app_stream(self, center);
+	app_update(self);
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	for (int32_t i = 0; i < 1; i++)
-		for(int32_t j = 0; j < 1; j++)
-			for(int32_t k = 0; k < 1; k++) {
-		chunk_draw(self->chunks[i][j]+k);
-	}
+	for (size_t i = 0; i < self->chunk_count; i++)
+		if (atomic_load(&self->chunks[i]->state) == CHUNK_LOADED)
+			app_chunk_draw(self->chunks[i]);
 
 	glfwSwapBuffers(self->window);
 	glfwPollEvents();
@@ -335,6 +636,10 @@ bool app_loop(app_t *self) {
 }
 
 int main() {
-	app_t *app = malloc(sizeof(app_t));
+	app_t *app = calloc(1, sizeof(app_t));
 	for (app_setup(app);app_loop(app););
+
+	app_clear(app);
+	task_pool_free(&app->tasks);
+	gen_noise_release();
 }
@@ -32,11 +32,33 @@
 #define NORM_CONSTANT_3D (103.0)
 #define NORM_CONSTANT_4D (30.0)
 
+/*
+ * Bound on |noise| used to decide when remaining fractal octaves are
+ * irrelevant. Every lattice vertex in range adds attn^4 * (g . d) / NORM,
+ * so whatever the permutation, |noise| is at most the sum over them of
+ * attn^4 * max_g |g . d| / NORM. That sum only depends on the position
+ * within a lattice cell. Its maximum over a 160^3 grid of the cell is
+ * 0.9872 and its slope stays below 4.7 per lattice unit, so between grid
+ * points it cannot pass 1.013. The rest of the margin covers float
+ * rounding and OSN_GRID_TOLERANCE. A larger bound only costs skipped
+ * octaves; a smaller one could cut octaves that still flip the sign.
+ * Ridged octaves fold any |noise| <= 2 into [-1, 1], so this bounds them
+ * too.
+ */
+#define NOISE_BOUND_3D (1.02)
+
 #define DEFAULT_SEED (0LL)
 
+#define CACHE_LINE_SIZE 64
+#define PERM_SIZE 256
+
+/*
+ * The tables live inline and start on a cache line so that a context shared
+ * between threads is one contiguous, read-only 1 KiB block.
+ */
 struct osn_context {
-	int16_t *perm;
-	int16_t *permGradIndex3D;
+	_Alignas(CACHE_LINE_SIZE) int16_t perm[PERM_SIZE];
+	_Alignas(CACHE_LINE_SIZE) int16_t permGradIndex3D[PERM_SIZE];
 };
 
 #define ARRAYSIZE(x) (sizeof((x)) / sizeof((x)[0]))
@@ -94,66 +116,60 @@ static const signed char gradients4D[] = {
 	-3, -1, -1, -1,     -1, -3, -1, -1,     -1, -1, -3, -1,     -1, -1, -1, -3,
 };
 
-static double extrapolate2(const struct osn_context *ctx, int xsb, int ysb, double dx, double dy)
-{
-	const int16_t *perm = ctx->perm;
-	int index = perm[(perm[xsb & 0xFF] + ysb) & 0xFF] & 0x0E;
-	return gradients2D[index] * dx
-		+ gradients2D[index + 1] * dy;
-}
-
-static double extrapolate3(const struct osn_context *ctx, int xsb, int ysb, int zsb, double dx, double dy, double dz)
-{
-	const int16_t *perm = ctx->perm;
-	const int16_t *permGradIndex3D = ctx->permGradIndex3D;
-	int index = permGradIndex3D[(perm[(perm[xsb & 0xFF] + ysb) & 0xFF] + zsb) & 0xFF];
-	return gradients3D[index] * dx
-		+ gradients3D[index + 1] * dy
-		+ gradients3D[index + 2] * dz;
-}
-
-static double extrapolate4(const struct osn_context *ctx, int xsb, int ysb, int zsb, int wsb, double dx, double dy, double dz, double dw)
-{
-	const int16_t *perm = ctx->perm;
-	int index = perm[(perm[(perm[(perm[xsb & 0xFF] + ysb) & 0xFF] + zsb) & 0xFF] + wsb) & 0xFF] & 0xFC;
-	return gradients4D[index] * dx
-		+ gradients4D[index + 1] * dy
-		+ gradients4D[index + 2] * dz
-		+ gradients4D[index + 3] * dw;
-}
+/*
+ * Batched 3D grid evaluation.
+ *
+ * Reproducing the region selection of open_simplex_noise3 lane by lane
+ * would need a blend for every branch, so the grid kernels instead sum the
+ * contribution of every lattice vertex that can fall within the attenuation
+ * radius of the containing rhombohedron. Those 26 vertices are listed below,
+ * relative to the super-cell origin. open_simplex_noise3 skips a few distant
+ * vertices that still carry a tiny weight, so the grid output differs from it
+ * by at most OSN_GRID_TOLERANCE (see simplex.h). All grid kernels perform the
+ * same operations in the same order, so the scalar, SSE2 and AVX2 paths agree
+ * bit-for-bit with each other.
+ */
+static const int8_t gridVertices3D[] = {
+	 0,  0,  0,      1,  0,  0,      0,  1,  0,      0,  0,  1,
+	 1,  1,  0,      1,  0,  1,      0,  1,  1,      1,  1,  1,
+	-1,  1,  1,      1, -1,  1,      1,  1, -1,
+	 2,  0,  0,      0,  2,  0,      0,  0,  2,
+	-1,  0,  1,     -1,  1,  0,      0, -1,  1,
+	 0,  1, -1,      1, -1,  0,      1,  0, -1,
+	 0,  1,  2,      0,  2,  1,      1,  0,  2,
+	 1,  2,  0,      2,  0,  1,      2,  1,  0,
+};
 
-static INLINE int fastFloor(double x) {
-	int xi = (int) x;
-	return x < xi ? xi - 1 : xi;
-}
+#define GRID_VERTS_3D (ARRAYSIZE(gridVertices3D) / 3)
 
-static int allocate_perm(struct osn_context *ctx, int nperm, int ngrad)
-{
-	if (ctx->perm)
-		free(ctx->perm);
-	if (ctx->permGradIndex3D)
-		free(ctx->permGradIndex3D);
-	ctx->perm = (int16_t *) malloc(sizeof(*ctx->perm) * nperm);
-	if (!ctx->perm)
-		return -ENOMEM;
-	ctx->permGradIndex3D = (int16_t *) malloc(sizeof(*ctx->permGradIndex3D) * ngrad);
-	if (!ctx->permGradIndex3D) {
-		free(ctx->perm);
-		return -ENOMEM;
-	}
-	return 0;
-}
+/*
+ * The grid helpers are inlined into each kernel so that they are compiled
+ * for the kernel's instruction set; calling out to plain SSE code from the
+ * AVX2 kernel costs a state transition per call.
+ */
+#ifdef __GNUC__
+	#define GRID_INLINE INLINE __attribute__((always_inline))
+#else
+	#define GRID_INLINE INLINE
+#endif
 
 int open_simplex_noise_init_perm(struct osn_context *ctx, int16_t p[], int nelements)
 {
-	int i, rc;
-
-	rc = allocate_perm(ctx, nelements, 256);
-	if (rc)
-		return rc;
-	memcpy(ctx->perm, p, sizeof(*ctx->perm) * nelements);
+	int i;
 
-	for (i = 0; i < 256; i++) {
+	/*
+	 * Contexts are shared read-only once built, so every entry has to come
+	 * from the caller; a short table would leave the rest of perm unset.
+	 * Entries index the gradient tables and must lie in [0, PERM_SIZE).
+	 */
+	if (nelements != PERM_SIZE)
+		return -EINVAL;
+	for (i = 0; i < PERM_SIZE; i++)
+		if (p[i] < 0 || p[i] >= PERM_SIZE)
+			return -EINVAL;
+	memcpy(ctx->perm, p, sizeof(*ctx->perm) * PERM_SIZE);
+
+	for (i = 0; i < PERM_SIZE; i++) {
 		/* Since 3D has 24 gradients, simple bitmask won't work, so precompute modulo array. */
 		ctx->permGradIndex3D[i] = (int16_t)((ctx->perm[i] % (ARRAYSIZE(gradients3D) / 3)) * 3);
 	}
@@ -167,24 +183,15 @@ int open_simplex_noise_init_perm(struct osn_context *ctx, int16_t p[], int nelem
  */
 int open_simplex_noise(int64_t seed, struct osn_context **ctx)
 {
-	int rc;
-	int16_t source[256];
+	int16_t source[PERM_SIZE];
 	int i;
 	int16_t *perm;
 	int16_t *permGradIndex3D;
 	int r;
 
-	*ctx = (struct osn_context *) malloc(sizeof(**ctx));
+	*ctx = (struct osn_context *) aligned_alloc(CACHE_LINE_SIZE, sizeof(**ctx));
 	if (!(*ctx))
 		return -ENOMEM;
-	(*ctx)->perm = NULL;
-	(*ctx)->permGradIndex3D = NULL;
-
-	rc = allocate_perm(*ctx, 256, 256);
-	if (rc) {
-		free(*ctx);
-		return rc;
-	}
 
 	perm = (*ctx)->perm;
 	permGradIndex3D = (*ctx)->permGradIndex3D;
@@ -209,2042 +216,314 @@ int open_simplex_noise(int64_t seed, struct osn_context **ctx)
 
 void open_simplex_noise_free(struct osn_context *ctx)
 {
-	if (!ctx)
-		return;
-	if (ctx->perm) {
-		free(ctx->perm);
-		ctx->perm = NULL;
-	}
-	if (ctx->permGradIndex3D) {
-		free(ctx->permGradIndex3D);
-		ctx->permGradIndex3D = NULL;
-	}
 	free(ctx);
 }
 
-/* 2D OpenSimplex (Simplectic) Noise. */
-double open_simplex_noise2(const struct osn_context *ctx, double x, double y)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSN_GRID_X86
+#include <immintrin.h>
+#endif
+
+#define OSN_K(c) ((OSN_REAL) (c))
+
+#define OSN_REAL double
+#define OSN_FN(name) name
+#include "simplex_impl.h"
+#undef OSN_FN
+#undef OSN_REAL
+
+#define OSN_REAL float
+#define OSN_FN(name) name ## f
+#include "simplex_impl.h"
+#undef OSN_FN
+#undef OSN_REAL
+
+#ifdef OSN_GRID_X86
+__attribute__((target("sse2")))
+static void grid_row3_sse2(const struct osn_context *ctx, struct grid_cell3 *cell,
+	double x, double y, double z0, double step, int n, double *out)
 {
-
-	/* Place input coordinates onto grid. */
-	double stretchOffset = (x + y) * STRETCH_CONSTANT_2D;
-	double xs = x + stretchOffset;
-	double ys = y + stretchOffset;
-
-	/* Floor to get grid coordinates of rhombus (stretched square) super-cell origin. */
-	int xsb = fastFloor(xs);
-	int ysb = fastFloor(ys);
-
-	/* Skew out to get actual coordinates of rhombus origin. We'll need these later. */
-	double squishOffset = (xsb + ysb) * SQUISH_CONSTANT_2D;
-	double xb = xsb + squishOffset;
-	double yb = ysb + squishOffset;
-
-	/* Compute grid coordinates relative to rhombus origin. */
-	double xins = xs - xsb;
-	double yins = ys - ysb;
-
-	/* Sum those together to get a value that determines which region we're in. */
-	double inSum = xins + yins;
-
-	/* Positions relative to origin point. */
-	double dx0 = x - xb;
-	double dy0 = y - yb;
-
-	/* We'll be defining these inside the next block and using them afterwards. */
-	double dx_ext, dy_ext;
-	int xsv_ext, ysv_ext;
-
-	double dx1;
-	double dy1;
-	double attn1;
-	double dx2;
-	double dy2;
-	double attn2;
-	double zins;
-	double attn0;
-	double attn_ext;
-
-	double value = 0;
-
-	/* Contribution (1,0) */
-	dx1 = dx0 - 1 - SQUISH_CONSTANT_2D;
-	dy1 = dy0 - 0 - SQUISH_CONSTANT_2D;
-	attn1 = 2 - dx1 * dx1 - dy1 * dy1;
-	if (attn1 > 0) {
-		attn1 *= attn1;
-		value += attn1 * attn1 * extrapolate2(ctx, xsb + 1, ysb + 0, dx1, dy1);
-	}
-
-	/* Contribution (0,1) */
-	dx2 = dx0 - 0 - SQUISH_CONSTANT_2D;
-	dy2 = dy0 - 1 - SQUISH_CONSTANT_2D;
-	attn2 = 2 - dx2 * dx2 - dy2 * dy2;
-	if (attn2 > 0) {
-		attn2 *= attn2;
-		value += attn2 * attn2 * extrapolate2(ctx, xsb + 0, ysb + 1, dx2, dy2);
+	int i, k, l;
+	double z[2];
+
+	for (k = 0; k + 2 <= n; k += 2) {
+		for (l = 0; l < 2; l++)
+			z[l] = z0 + (k + l) * step;
+
+		if (!grid_lanes3_shared(ctx, cell, x, y, z, 2)) {
+			for (l = 0; l < 2; l++)
+				out[k + l] = grid_sample3(ctx, cell, x, y, z[l]);
+			continue;
+		}
+
+		__m128d vz = _mm_loadu_pd(z);
+		__m128d value = _mm_setzero_pd();
+		for (i = 0; i < cell->nactive; i++) {
+			__m128d dz = _mm_sub_pd(vz, _mm_set1_pd(cell->vz[i]));
+			__m128d attn = _mm_sub_pd(_mm_set1_pd(cell->attnxy[i]), _mm_mul_pd(dz, dz));
+			__m128d mask = _mm_cmpgt_pd(attn, _mm_setzero_pd());
+			__m128d grad = _mm_add_pd(_mm_set1_pd(cell->gradxy[i]), _mm_mul_pd(_mm_set1_pd(cell->gz[i]), dz));
+			attn = _mm_mul_pd(attn, attn);
+			value = _mm_add_pd(value, _mm_and_pd(mask, _mm_mul_pd(_mm_mul_pd(attn, attn), grad)));
+		}
+		_mm_storeu_pd(out + k, _mm_div_pd(value, _mm_set1_pd(NORM_CONSTANT_3D)));
 	}
 
-	if (inSum <= 1) { /* We're inside the triangle (2-Simplex) at (0,0) */
-		zins = 1 - inSum;
-		if (zins > xins || zins > yins) { /* (0,0) is one of the closest two triangular vertices */
-			if (xins > yins) {
-				xsv_ext = xsb + 1;
-				ysv_ext = ysb - 1;
-				dx_ext = dx0 - 1;
-				dy_ext = dy0 + 1;
-			} else {
-				xsv_ext = xsb - 1;
-				ysv_ext = ysb + 1;
-				dx_ext = dx0 + 1;
-				dy_ext = dy0 - 1;
-			}
-		} else { /* (1,0) and (0,1) are the closest two vertices. */
-			xsv_ext = xsb + 1;
-			ysv_ext = ysb + 1;
-			dx_ext = dx0 - 1 - 2 * SQUISH_CONSTANT_2D;
-			dy_ext = dy0 - 1 - 2 * SQUISH_CONSTANT_2D;
-		}
-	} else { /* We're inside the triangle (2-Simplex) at (1,1) */
-		zins = 2 - inSum;
-		if (zins < xins || zins < yins) { /* (0,0) is one of the closest two triangular vertices */
-			if (xins > yins) {
-				xsv_ext = xsb + 2;
-				ysv_ext = ysb + 0;
-				dx_ext = dx0 - 2 - 2 * SQUISH_CONSTANT_2D;
-				dy_ext = dy0 + 0 - 2 * SQUISH_CONSTANT_2D;
-			} else {
-				xsv_ext = xsb + 0;
-				ysv_ext = ysb + 2;
-				dx_ext = dx0 + 0 - 2 * SQUISH_CONSTANT_2D;
-				dy_ext = dy0 - 2 - 2 * SQUISH_CONSTANT_2D;
-			}
-		} else { /* (1,0) and (0,1) are the closest two vertices. */
-			dx_ext = dx0;
-			dy_ext = dy0;
-			xsv_ext = xsb;
-			ysv_ext = ysb;
-		}
-		xsb += 1;
-		ysb += 1;
-		dx0 = dx0 - 1 - 2 * SQUISH_CONSTANT_2D;
-		dy0 = dy0 - 1 - 2 * SQUISH_CONSTANT_2D;
-	}
+	for (; k < n; k++)
+		out[k] = grid_sample3(ctx, cell, x, y, z0 + k * step);
+}
 
-	/* Contribution (0,0) or (1,1) */
-	attn0 = 2 - dx0 * dx0 - dy0 * dy0;
-	if (attn0 > 0) {
-		attn0 *= attn0;
-		value += attn0 * attn0 * extrapolate2(ctx, xsb, ysb, dx0, dy0);
+__attribute__((target("avx2")))
+static void grid_row3_avx2(const struct osn_context *ctx, struct grid_cell3 *cell,
+	double x, double y, double z0, double step, int n, double *out)
+{
+	int i, k, l;
+	double z[4];
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		for (l = 0; l < 4; l++)
+			z[l] = z0 + (k + l) * step;
+
+		if (!grid_lanes3_shared(ctx, cell, x, y, z, 4)) {
+			for (l = 0; l < 4; l++)
+				out[k + l] = grid_sample3(ctx, cell, x, y, z[l]);
+			continue;
+		}
+
+		__m256d vz = _mm256_loadu_pd(z);
+		__m256d value = _mm256_setzero_pd();
+		for (i = 0; i < cell->nactive; i++) {
+			__m256d dz = _mm256_sub_pd(vz, _mm256_set1_pd(cell->vz[i]));
+			__m256d attn = _mm256_sub_pd(_mm256_set1_pd(cell->attnxy[i]), _mm256_mul_pd(dz, dz));
+			__m256d mask = _mm256_cmp_pd(attn, _mm256_setzero_pd(), _CMP_GT_OQ);
+			__m256d grad = _mm256_add_pd(_mm256_set1_pd(cell->gradxy[i]), _mm256_mul_pd(_mm256_set1_pd(cell->gz[i]), dz));
+			attn = _mm256_mul_pd(attn, attn);
+			value = _mm256_add_pd(value, _mm256_and_pd(mask, _mm256_mul_pd(_mm256_mul_pd(attn, attn), grad)));
+		}
+		_mm256_storeu_pd(out + k, _mm256_div_pd(value, _mm256_set1_pd(NORM_CONSTANT_3D)));
 	}
 
-	/* Extra Vertex */
-	attn_ext = 2 - dx_ext * dx_ext - dy_ext * dy_ext;
-	if (attn_ext > 0) {
-		attn_ext *= attn_ext;
-		value += attn_ext * attn_ext * extrapolate2(ctx, xsv_ext, ysv_ext, dx_ext, dy_ext);
+	for (; k < n; k++)
+		out[k] = grid_sample3(ctx, cell, x, y, z0 + k * step);
+}
+__attribute__((target("sse2")))
+static void grid_row3f_sse(const struct osn_context *ctx, struct grid_cell3f *cell,
+	float x, float y, float z0, float step, int n, float *out)
+{
+	int i, k, l;
+	float z[4];
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		for (l = 0; l < 4; l++)
+			z[l] = z0 + (k + l) * step;
+
+		if (!grid_lanes3_sharedf(ctx, cell, x, y, z, 4)) {
+			for (l = 0; l < 4; l++)
+				out[k + l] = grid_sample3f(ctx, cell, x, y, z[l]);
+			continue;
+		}
+
+		__m128 vz = _mm_loadu_ps(z);
+		__m128 value = _mm_setzero_ps();
+		for (i = 0; i < cell->nactive; i++) {
+			__m128 dz = _mm_sub_ps(vz, _mm_set1_ps(cell->vz[i]));
+			__m128 attn = _mm_sub_ps(_mm_set1_ps(cell->attnxy[i]), _mm_mul_ps(dz, dz));
+			__m128 mask = _mm_cmpgt_ps(attn, _mm_setzero_ps());
+			__m128 grad = _mm_add_ps(_mm_set1_ps(cell->gradxy[i]), _mm_mul_ps(_mm_set1_ps(cell->gz[i]), dz));
+			attn = _mm_mul_ps(attn, attn);
+			value = _mm_add_ps(value, _mm_and_ps(mask, _mm_mul_ps(_mm_mul_ps(attn, attn), grad)));
+		}
+		_mm_storeu_ps(out + k, _mm_div_ps(value, _mm_set1_ps((float) NORM_CONSTANT_3D)));
 	}
 
-	return value / NORM_CONSTANT_2D;
+	for (; k < n; k++)
+		out[k] = grid_sample3f(ctx, cell, x, y, z0 + k * step);
 }
 
-/*
- * 3D OpenSimplex (Simplectic) Noise
- */
-double open_simplex_noise3(const struct osn_context *ctx, double x, double y, double z)
+__attribute__((target("avx2")))
+static void grid_row3f_avx2(const struct osn_context *ctx, struct grid_cell3f *cell,
+	float x, float y, float z0, float step, int n, float *out)
 {
+	int i, k, l;
+	float z[8];
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		for (l = 0; l < 8; l++)
+			z[l] = z0 + (k + l) * step;
+
+		if (!grid_lanes3_sharedf(ctx, cell, x, y, z, 8)) {
+			for (l = 0; l < 8; l++)
+				out[k + l] = grid_sample3f(ctx, cell, x, y, z[l]);
+			continue;
+		}
+
+		__m256 vz = _mm256_loadu_ps(z);
+		__m256 value = _mm256_setzero_ps();
+		for (i = 0; i < cell->nactive; i++) {
+			__m256 dz = _mm256_sub_ps(vz, _mm256_set1_ps(cell->vz[i]));
+			__m256 attn = _mm256_sub_ps(_mm256_set1_ps(cell->attnxy[i]), _mm256_mul_ps(dz, dz));
+			__m256 mask = _mm256_cmp_ps(attn, _mm256_setzero_ps(), _CMP_GT_OQ);
+			__m256 grad = _mm256_add_ps(_mm256_set1_ps(cell->gradxy[i]), _mm256_mul_ps(_mm256_set1_ps(cell->gz[i]), dz));
+			attn = _mm256_mul_ps(attn, attn);
+			value = _mm256_add_ps(value, _mm256_and_ps(mask, _mm256_mul_ps(_mm256_mul_ps(attn, attn), grad)));
+		}
+		_mm256_storeu_ps(out + k, _mm256_div_ps(value, _mm256_set1_ps((float) NORM_CONSTANT_3D)));
+	}
 
-	/* Place input coordinates on simplectic honeycomb. */
-	double stretchOffset = (x + y + z) * STRETCH_CONSTANT_3D;
-	double xs = x + stretchOffset;
-	double ys = y + stretchOffset;
-	double zs = z + stretchOffset;
-
-	/* Floor to get simplectic honeycomb coordinates of rhombohedron (stretched cube) super-cell origin. */
-	int xsb = fastFloor(xs);
-	int ysb = fastFloor(ys);
-	int zsb = fastFloor(zs);
-
-	/* Skew out to get actual coordinates of rhombohedron origin. We'll need these later. */
-	double squishOffset = (xsb + ysb + zsb) * SQUISH_CONSTANT_3D;
-	double xb = xsb + squishOffset;
-	double yb = ysb + squishOffset;
-	double zb = zsb + squishOffset;
-
-	/* Compute simplectic honeycomb coordinates relative to rhombohedral origin. */
-	double xins = xs - xsb;
-	double yins = ys - ysb;
-	double zins = zs - zsb;
-
-	/* Sum those together to get a value that determines which region we're in. */
-	double inSum = xins + yins + zins;
-
-	/* Positions relative to origin point. */
-	double dx0 = x - xb;
-	double dy0 = y - yb;
-	double dz0 = z - zb;
-
-	/* We'll be defining these inside the next block and using them afterwards. */
-	double dx_ext0, dy_ext0, dz_ext0;
-	double dx_ext1, dy_ext1, dz_ext1;
-	int xsv_ext0, ysv_ext0, zsv_ext0;
-	int xsv_ext1, ysv_ext1, zsv_ext1;
-
-	double wins;
-	int8_t c, c1, c2;
-	int8_t aPoint, bPoint;
-	double aScore, bScore;
-	int aIsFurtherSide;
-	int bIsFurtherSide;
-	double p1, p2, p3;
-	double score;
-	double attn0, attn1, attn2, attn3, attn4, attn5, attn6;
-	double dx1, dy1, dz1;
-	double dx2, dy2, dz2;
-	double dx3, dy3, dz3;
-	double dx4, dy4, dz4;
-	double dx5, dy5, dz5;
-	double dx6, dy6, dz6;
-	double attn_ext0, attn_ext1;
-
-	double value = 0;
-	if (inSum <= 1) { /* We're inside the tetrahedron (3-Simplex) at (0,0,0) */
-
-		/* Determine which two of (0,0,1), (0,1,0), (1,0,0) are closest. */
-		aPoint = 0x01;
-		aScore = xins;
-		bPoint = 0x02;
-		bScore = yins;
-		if (aScore >= bScore && zins > bScore) {
-			bScore = zins;
-			bPoint = 0x04;
-		} else if (aScore < bScore && zins > aScore) {
-			aScore = zins;
-			aPoint = 0x04;
-		}
-
-		/* Now we determine the two lattice points not part of the tetrahedron that may contribute.
-		   This depends on the closest two tetrahedral vertices, including (0,0,0) */
-		wins = 1 - inSum;
-		if (wins > aScore || wins > bScore) { /* (0,0,0) is one of the closest two tetrahedral vertices. */
-			c = (bScore > aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
-
-			if ((c & 0x01) == 0) {
-				xsv_ext0 = xsb - 1;
-				xsv_ext1 = xsb;
-				dx_ext0 = dx0 + 1;
-				dx_ext1 = dx0;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsb + 1;
-				dx_ext0 = dx_ext1 = dx0 - 1;
-			}
-
-			if ((c & 0x02) == 0) {
-				ysv_ext0 = ysv_ext1 = ysb;
-				dy_ext0 = dy_ext1 = dy0;
-				if ((c & 0x01) == 0) {
-					ysv_ext1 -= 1;
-					dy_ext1 += 1;
-				} else {
-					ysv_ext0 -= 1;
-					dy_ext0 += 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysb + 1;
-				dy_ext0 = dy_ext1 = dy0 - 1;
-			}
-
-			if ((c & 0x04) == 0) {
-				zsv_ext0 = zsb;
-				zsv_ext1 = zsb - 1;
-				dz_ext0 = dz0;
-				dz_ext1 = dz0 + 1;
-			} else {
-				zsv_ext0 = zsv_ext1 = zsb + 1;
-				dz_ext0 = dz_ext1 = dz0 - 1;
-			}
-		} else { /* (0,0,0) is not one of the closest two tetrahedral vertices. */
-			c = (int8_t)(aPoint | bPoint); /* Our two extra vertices are determined by the closest two. */
-
-			if ((c & 0x01) == 0) {
-				xsv_ext0 = xsb;
-				xsv_ext1 = xsb - 1;
-				dx_ext0 = dx0 - 2 * SQUISH_CONSTANT_3D;
-				dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_3D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsb + 1;
-				dx_ext0 = dx0 - 1 - 2 * SQUISH_CONSTANT_3D;
-				dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3D;
-			}
-
-			if ((c & 0x02) == 0) {
-				ysv_ext0 = ysb;
-				ysv_ext1 = ysb - 1;
-				dy_ext0 = dy0 - 2 * SQUISH_CONSTANT_3D;
-				dy_ext1 = dy0 + 1 - SQUISH_CONSTANT_3D;
-			} else {
-				ysv_ext0 = ysv_ext1 = ysb + 1;
-				dy_ext0 = dy0 - 1 - 2 * SQUISH_CONSTANT_3D;
-				dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3D;
-			}
-
-			if ((c & 0x04) == 0) {
-				zsv_ext0 = zsb;
-				zsv_ext1 = zsb - 1;
-				dz_ext0 = dz0 - 2 * SQUISH_CONSTANT_3D;
-				dz_ext1 = dz0 + 1 - SQUISH_CONSTANT_3D;
-			} else {
-				zsv_ext0 = zsv_ext1 = zsb + 1;
-				dz_ext0 = dz0 - 1 - 2 * SQUISH_CONSTANT_3D;
-				dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3D;
-			}
-		}
-
-		/* Contribution (0,0,0) */
-		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0;
-		if (attn0 > 0) {
-			attn0 *= attn0;
-			value += attn0 * attn0 * extrapolate3(ctx, xsb + 0, ysb + 0, zsb + 0, dx0, dy0, dz0);
-		}
-
-		/* Contribution (1,0,0) */
-		dx1 = dx0 - 1 - SQUISH_CONSTANT_3D;
-		dy1 = dy0 - 0 - SQUISH_CONSTANT_3D;
-		dz1 = dz0 - 0 - SQUISH_CONSTANT_3D;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate3(ctx, xsb + 1, ysb + 0, zsb + 0, dx1, dy1, dz1);
-		}
-
-		/* Contribution (0,1,0) */
-		dx2 = dx0 - 0 - SQUISH_CONSTANT_3D;
-		dy2 = dy0 - 1 - SQUISH_CONSTANT_3D;
-		dz2 = dz1;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate3(ctx, xsb + 0, ysb + 1, zsb + 0, dx2, dy2, dz2);
-		}
-
-		/* Contribution (0,0,1) */
-		dx3 = dx2;
-		dy3 = dy1;
-		dz3 = dz0 - 1 - SQUISH_CONSTANT_3D;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate3(ctx, xsb + 0, ysb + 0, zsb + 1, dx3, dy3, dz3);
-		}
-	} else if (inSum >= 2) { /* We're inside the tetrahedron (3-Simplex) at (1,1,1) */
-
-		/* Determine which two tetrahedral vertices are the closest, out of (1,1,0), (1,0,1), (0,1,1) but not (1,1,1). */
-		aPoint = 0x06;
-		aScore = xins;
-		bPoint = 0x05;
-		bScore = yins;
-		if (aScore <= bScore && zins < bScore) {
-			bScore = zins;
-			bPoint = 0x03;
-		} else if (aScore > bScore && zins < aScore) {
-			aScore = zins;
-			aPoint = 0x03;
-		}
-
-		/* Now we determine the two lattice points not part of the tetrahedron that may contribute.
-		   This depends on the closest two tetrahedral vertices, including (1,1,1) */
-		wins = 3 - inSum;
-		if (wins < aScore || wins < bScore) { /* (1,1,1) is one of the closest two tetrahedral vertices. */
-			c = (bScore < aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
-
-			if ((c & 0x01) != 0) {
-				xsv_ext0 = xsb + 2;
-				xsv_ext1 = xsb + 1;
-				dx_ext0 = dx0 - 2 - 3 * SQUISH_CONSTANT_3D;
-				dx_ext1 = dx0 - 1 - 3 * SQUISH_CONSTANT_3D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsb;
-				dx_ext0 = dx_ext1 = dx0 - 3 * SQUISH_CONSTANT_3D;
-			}
-
-			if ((c & 0x02) != 0) {
-				ysv_ext0 = ysv_ext1 = ysb + 1;
-				dy_ext0 = dy_ext1 = dy0 - 1 - 3 * SQUISH_CONSTANT_3D;
-				if ((c & 0x01) != 0) {
-					ysv_ext1 += 1;
-					dy_ext1 -= 1;
-				} else {
-					ysv_ext0 += 1;
-					dy_ext0 -= 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysb;
-				dy_ext0 = dy_ext1 = dy0 - 3 * SQUISH_CONSTANT_3D;
-			}
-
-			if ((c & 0x04) != 0) {
-				zsv_ext0 = zsb + 1;
-				zsv_ext1 = zsb + 2;
-				dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3D;
-				dz_ext1 = dz0 - 2 - 3 * SQUISH_CONSTANT_3D;
-			} else {
-				zsv_ext0 = zsv_ext1 = zsb;
-				dz_ext0 = dz_ext1 = dz0 - 3 * SQUISH_CONSTANT_3D;
-			}
-		} else { /* (1,1,1) is not one of the closest two tetrahedral vertices. */
-			c = (int8_t)(aPoint & bPoint); /* Our two extra vertices are determined by the closest two. */
-
-			if ((c & 0x01) != 0) {
-				xsv_ext0 = xsb + 1;
-				xsv_ext1 = xsb + 2;
-				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3D;
-				dx_ext1 = dx0 - 2 - 2 * SQUISH_CONSTANT_3D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsb;
-				dx_ext0 = dx0 - SQUISH_CONSTANT_3D;
-				dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3D;
-			}
-
-			if ((c & 0x02) != 0) {
-				ysv_ext0 = ysb + 1;
-				ysv_ext1 = ysb + 2;
-				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3D;
-				dy_ext1 = dy0 - 2 - 2 * SQUISH_CONSTANT_3D;
-			} else {
-				ysv_ext0 = ysv_ext1 = ysb;
-				dy_ext0 = dy0 - SQUISH_CONSTANT_3D;
-				dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3D;
-			}
-
-			if ((c & 0x04) != 0) {
-				zsv_ext0 = zsb + 1;
-				zsv_ext1 = zsb + 2;
-				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3D;
-				dz_ext1 = dz0 - 2 - 2 * SQUISH_CONSTANT_3D;
-			} else {
-				zsv_ext0 = zsv_ext1 = zsb;
-				dz_ext0 = dz0 - SQUISH_CONSTANT_3D;
-				dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3D;
-			}
-		}
-
-		/* Contribution (1,1,0) */
-		dx3 = dx0 - 1 - 2 * SQUISH_CONSTANT_3D;
-		dy3 = dy0 - 1 - 2 * SQUISH_CONSTANT_3D;
-		dz3 = dz0 - 0 - 2 * SQUISH_CONSTANT_3D;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate3(ctx, xsb + 1, ysb + 1, zsb + 0, dx3, dy3, dz3);
-		}
-
-		/* Contribution (1,0,1) */
-		dx2 = dx3;
-		dy2 = dy0 - 0 - 2 * SQUISH_CONSTANT_3D;
-		dz2 = dz0 - 1 - 2 * SQUISH_CONSTANT_3D;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate3(ctx, xsb + 1, ysb + 0, zsb + 1, dx2, dy2, dz2);
-		}
-
-		/* Contribution (0,1,1) */
-		dx1 = dx0 - 0 - 2 * SQUISH_CONSTANT_3D;
-		dy1 = dy3;
-		dz1 = dz2;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate3(ctx, xsb + 0, ysb + 1, zsb + 1, dx1, dy1, dz1);
-		}
-
-		/* Contribution (1,1,1) */
-		dx0 = dx0 - 1 - 3 * SQUISH_CONSTANT_3D;
-		dy0 = dy0 - 1 - 3 * SQUISH_CONSTANT_3D;
-		dz0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3D;
-		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0;
-		if (attn0 > 0) {
-			attn0 *= attn0;
-			value += attn0 * attn0 * extrapolate3(ctx, xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
-		}
-	} else { /* We're inside the octahedron (Rectified 3-Simplex) in between.
-		        Decide between point (0,0,1) and (1,1,0) as closest */
-		p1 = xins + yins;
-		if (p1 > 1) {
-			aScore = p1 - 1;
-			aPoint = 0x03;
-			aIsFurtherSide = 1;
-		} else {
-			aScore = 1 - p1;
-			aPoint = 0x04;
-			aIsFurtherSide = 0;
-		}
-
-		/* Decide between point (0,1,0) and (1,0,1) as closest */
-		p2 = xins + zins;
-		if (p2 > 1) {
-			bScore = p2 - 1;
-			bPoint = 0x05;
-			bIsFurtherSide = 1;
-		} else {
-			bScore = 1 - p2;
-			bPoint = 0x02;
-			bIsFurtherSide = 0;
-		}
-
-		/* The closest out of the two (1,0,0) and (0,1,1) will replace the furthest out of the two decided above, if closer. */
-		p3 = yins + zins;
-		if (p3 > 1) {
-			score = p3 - 1;
-			if (aScore <= bScore && aScore < score) {
-				aScore = score;
-				aPoint = 0x06;
-				aIsFurtherSide = 1;
-			} else if (aScore > bScore && bScore < score) {
-				bScore = score;
-				bPoint = 0x06;
-				bIsFurtherSide = 1;
-			}
-		} else {
-			score = 1 - p3;
-			if (aScore <= bScore && aScore < score) {
-				aScore = score;
-				aPoint = 0x01;
-				aIsFurtherSide = 0;
-			} else if (aScore > bScore && bScore < score) {
-				bScore = score;
-				bPoint = 0x01;
-				bIsFurtherSide = 0;
-			}
-		}
-
-		/* Where each of the two closest points are determines how the extra two vertices are calculated. */
-		if (aIsFurtherSide == bIsFurtherSide) {
-			if (aIsFurtherSide) { /* Both closest points on (1,1,1) side */
-
-				/* One of the two extra points is (1,1,1) */
-				dx_ext0 = dx0 - 1 - 3 * SQUISH_CONSTANT_3D;
-				dy_ext0 = dy0 - 1 - 3 * SQUISH_CONSTANT_3D;
-				dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_3D;
-				xsv_ext0 = xsb + 1;
-				ysv_ext0 = ysb + 1;
-				zsv_ext0 = zsb + 1;
-
-				/* Other extra point is based on the shared axis. */
-				c = (int8_t)(aPoint & bPoint);
-				if ((c & 0x01) != 0) {
-					dx_ext1 = dx0 - 2 - 2 * SQUISH_CONSTANT_3D;
-					dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3D;
-					dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3D;
-					xsv_ext1 = xsb + 2;
-					ysv_ext1 = ysb;
-					zsv_ext1 = zsb;
-				} else if ((c & 0x02) != 0) {
-					dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3D;
-					dy_ext1 = dy0 - 2 - 2 * SQUISH_CONSTANT_3D;
-					dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3D;
-					xsv_ext1 = xsb;
-					ysv_ext1 = ysb + 2;
-					zsv_ext1 = zsb;
-				} else {
-					dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3D;
-					dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3D;
-					dz_ext1 = dz0 - 2 - 2 * SQUISH_CONSTANT_3D;
-					xsv_ext1 = xsb;
-					ysv_ext1 = ysb;
-					zsv_ext1 = zsb + 2;
-				}
-			} else { /* Both closest points on (0,0,0) side */
-
-				/* One of the two extra points is (0,0,0) */
-				dx_ext0 = dx0;
-				dy_ext0 = dy0;
-				dz_ext0 = dz0;
-				xsv_ext0 = xsb;
-				ysv_ext0 = ysb;
-				zsv_ext0 = zsb;
-
-				/* Other extra point is based on the omitted axis. */
-				c = (int8_t)(aPoint | bPoint);
-				if ((c & 0x01) == 0) {
-					dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_3D;
-					dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3D;
-					dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3D;
-					xsv_ext1 = xsb - 1;
-					ysv_ext1 = ysb + 1;
-					zsv_ext1 = zsb + 1;
-				} else if ((c & 0x02) == 0) {
-					dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3D;
-					dy_ext1 = dy0 + 1 - SQUISH_CONSTANT_3D;
-					dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_3D;
-					xsv_ext1 = xsb + 1;
-					ysv_ext1 = ysb - 1;
-					zsv_ext1 = zsb + 1;
-				} else {
-					dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_3D;
-					dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_3D;
-					dz_ext1 = dz0 + 1 - SQUISH_CONSTANT_3D;
-					xsv_ext1 = xsb + 1;
-					ysv_ext1 = ysb + 1;
-					zsv_ext1 = zsb - 1;
-				}
-			}
-		} else { /* One point on (0,0,0) side, one point on (1,1,1) side */
-			if (aIsFurtherSide) {
-				c1 = aPoint;
-				c2 = bPoint;
-			} else {
-				c1 = bPoint;
-				c2 = aPoint;
-			}
-
-			/* One contribution is a permutation of (1,1,-1) */
-			if ((c1 & 0x01) == 0) {
-				dx_ext0 = dx0 + 1 - SQUISH_CONSTANT_3D;
-				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3D;
-				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3D;
-				xsv_ext0 = xsb - 1;
-				ysv_ext0 = ysb + 1;
-				zsv_ext0 = zsb + 1;
-			} else if ((c1 & 0x02) == 0) {
-				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3D;
-				dy_ext0 = dy0 + 1 - SQUISH_CONSTANT_3D;
-				dz_ext0 = dz0 - 1 - SQUISH_CONSTANT_3D;
-				xsv_ext0 = xsb + 1;
-				ysv_ext0 = ysb - 1;
-				zsv_ext0 = zsb + 1;
-			} else {
-				dx_ext0 = dx0 - 1 - SQUISH_CONSTANT_3D;
-				dy_ext0 = dy0 - 1 - SQUISH_CONSTANT_3D;
-				dz_ext0 = dz0 + 1 - SQUISH_CONSTANT_3D;
-				xsv_ext0 = xsb + 1;
-				ysv_ext0 = ysb + 1;
-				zsv_ext0 = zsb - 1;
-			}
-
-			/* One contribution is a permutation of (0,0,2) */
-			dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_3D;
-			dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_3D;
-			dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_3D;
-			xsv_ext1 = xsb;
-			ysv_ext1 = ysb;
-			zsv_ext1 = zsb;
-			if ((c2 & 0x01) != 0) {
-				dx_ext1 -= 2;
-				xsv_ext1 += 2;
-			} else if ((c2 & 0x02) != 0) {
-				dy_ext1 -= 2;
-				ysv_ext1 += 2;
-			} else {
-				dz_ext1 -= 2;
-				zsv_ext1 += 2;
-			}
-		}
-
-		/* Contribution (1,0,0) */
-		dx1 = dx0 - 1 - SQUISH_CONSTANT_3D;
-		dy1 = dy0 - 0 - SQUISH_CONSTANT_3D;
-		dz1 = dz0 - 0 - SQUISH_CONSTANT_3D;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate3(ctx, xsb + 1, ysb + 0, zsb + 0, dx1, dy1, dz1);
-		}
-
-		/* Contribution (0,1,0) */
-		dx2 = dx0 - 0 - SQUISH_CONSTANT_3D;
-		dy2 = dy0 - 1 - SQUISH_CONSTANT_3D;
-		dz2 = dz1;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate3(ctx, xsb + 0, ysb + 1, zsb + 0, dx2, dy2, dz2);
-		}
-
-		/* Contribution (0,0,1) */
-		dx3 = dx2;
-		dy3 = dy1;
-		dz3 = dz0 - 1 - SQUISH_CONSTANT_3D;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate3(ctx, xsb + 0, ysb + 0, zsb + 1, dx3, dy3, dz3);
-		}
-
-		/* Contribution (1,1,0) */
-		dx4 = dx0 - 1 - 2 * SQUISH_CONSTANT_3D;
-		dy4 = dy0 - 1 - 2 * SQUISH_CONSTANT_3D;
-		dz4 = dz0 - 0 - 2 * SQUISH_CONSTANT_3D;
-		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4;
-		if (attn4 > 0) {
-			attn4 *= attn4;
-			value += attn4 * attn4 * extrapolate3(ctx, xsb + 1, ysb + 1, zsb + 0, dx4, dy4, dz4);
-		}
-
-		/* Contribution (1,0,1) */
-		dx5 = dx4;
-		dy5 = dy0 - 0 - 2 * SQUISH_CONSTANT_3D;
-		dz5 = dz0 - 1 - 2 * SQUISH_CONSTANT_3D;
-		attn5 = 2 - dx5 * dx5 - dy5 * dy5 - dz5 * dz5;
-		if (attn5 > 0) {
-			attn5 *= attn5;
-			value += attn5 * attn5 * extrapolate3(ctx, xsb + 1, ysb + 0, zsb + 1, dx5, dy5, dz5);
-		}
+	for (; k < n; k++)
+		out[k] = grid_sample3f(ctx, cell, x, y, z0 + k * step);
+}
+#endif
 
-		/* Contribution (0,1,1) */
-		dx6 = dx0 - 0 - 2 * SQUISH_CONSTANT_3D;
-		dy6 = dy4;
-		dz6 = dz5;
-		attn6 = 2 - dx6 * dx6 - dy6 * dy6 - dz6 * dz6;
-		if (attn6 > 0) {
-			attn6 *= attn6;
-			value += attn6 * attn6 * extrapolate3(ctx, xsb + 0, ysb + 1, zsb + 1, dx6, dy6, dz6);
-		}
-	}
+static grid_row3_fn grid_row3_select(void)
+{
+#ifdef OSN_GRID_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return grid_row3_avx2;
+	if (__builtin_cpu_supports("sse2"))
+		return grid_row3_sse2;
+#endif
+	return grid_row3_scalar;
+}
 
-	/* First extra vertex */
-	attn_ext0 = 2 - dx_ext0 * dx_ext0 - dy_ext0 * dy_ext0 - dz_ext0 * dz_ext0;
-	if (attn_ext0 > 0)
-	{
-		attn_ext0 *= attn_ext0;
-		value += attn_ext0 * attn_ext0 * extrapolate3(ctx, xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
-	}
+void open_simplex_noise3_grid(const struct osn_context *ctx, double x0, double y0, double z0,
+	double step, int nx, int ny, int nz, double *out)
+{
+	grid_row3_fn row = grid_row3_select();
+	struct grid_cell3 cell;
+	int i, j;
+
+	cell.valid = 0;
+	for (i = 0; i < nx; i++)
+		for (j = 0; j < ny; j++)
+			row(ctx, &cell, x0 + i * step, y0 + j * step, z0, step, nz, out + ((size_t) i * ny + j) * nz);
+}
 
-	/* Second extra vertex */
-	attn_ext1 = 2 - dx_ext1 * dx_ext1 - dy_ext1 * dy_ext1 - dz_ext1 * dz_ext1;
-	if (attn_ext1 > 0)
-	{
-		attn_ext1 *= attn_ext1;
-		value += attn_ext1 * attn_ext1 * extrapolate3(ctx, xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
-	}
+static grid_row3_fnf grid_row3f_select(void)
+{
+#ifdef OSN_GRID_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return grid_row3f_avx2;
+	if (__builtin_cpu_supports("sse2"))
+		return grid_row3f_sse;
+#endif
+	return grid_row3_scalarf;
+}
 
-	return value / NORM_CONSTANT_3D;
+void open_simplex_noise3f_grid(const struct osn_context *ctx, float x0, float y0, float z0,
+	float step, int nx, int ny, int nz, float *out)
+{
+	grid_row3_fnf row = grid_row3f_select();
+	struct grid_cell3f cell;
+	int i, j;
+
+	cell.valid = 0;
+	for (i = 0; i < nx; i++)
+		for (j = 0; j < ny; j++)
+			row(ctx, &cell, x0 + i * step, y0 + j * step, z0, step, nz, out + ((size_t) i * ny + j) * nz);
 }
 
 /*
- * 4D OpenSimplex (Simplectic) Noise.
+ * Interval bound of the 3D noise over a box. Every vertex kernel that reaches
+ * the box contributes attn^4 * (g . d); attn is bounded by the nearest and
+ * farthest points of the box from the vertex and g . d is linear, so each
+ * term has an exact interval and their sum bounds the field.
  */
-double open_simplex_noise4(const struct osn_context *ctx, double x, double y, double z, double w)
+void open_simplex_noise3_bounds(const struct osn_context *ctx, double x0, double y0, double z0,
+	double x1, double y1, double z1, double *lo, double *hi)
 {
-	double uins;
-	double dx1, dy1, dz1, dw1;
-	double dx2, dy2, dz2, dw2;
-	double dx3, dy3, dz3, dw3;
-	double dx4, dy4, dz4, dw4;
-	double dx5, dy5, dz5, dw5;
-	double dx6, dy6, dz6, dw6;
-	double dx7, dy7, dz7, dw7;
-	double dx8, dy8, dz8, dw8;
-	double dx9, dy9, dz9, dw9;
-	double dx10, dy10, dz10, dw10;
-	double attn0, attn1, attn2, attn3, attn4;
-	double attn5, attn6, attn7, attn8, attn9, attn10;
-	double attn_ext0, attn_ext1, attn_ext2;
-	int8_t c, c1, c2;
-	int8_t aPoint, bPoint;
-	double aScore, bScore;
-	int aIsBiggerSide;
-	int bIsBiggerSide;
-	double p1, p2, p3, p4;
-	double score;
-
-	/* Place input coordinates on simplectic honeycomb. */
-	double stretchOffset = (x + y + z + w) * STRETCH_CONSTANT_4D;
-	double xs = x + stretchOffset;
-	double ys = y + stretchOffset;
-	double zs = z + stretchOffset;
-	double ws = w + stretchOffset;
-
-	/* Floor to get simplectic honeycomb coordinates of rhombo-hypercube super-cell origin. */
-	int xsb = fastFloor(xs);
-	int ysb = fastFloor(ys);
-	int zsb = fastFloor(zs);
-	int wsb = fastFloor(ws);
-
-	/* Skew out to get actual coordinates of stretched rhombo-hypercube origin. We'll need these later. */
-	double squishOffset = (xsb + ysb + zsb + wsb) * SQUISH_CONSTANT_4D;
-	double xb = xsb + squishOffset;
-	double yb = ysb + squishOffset;
-	double zb = zsb + squishOffset;
-	double wb = wsb + squishOffset;
-
-	/* Compute simplectic honeycomb coordinates relative to rhombo-hypercube origin. */
-	double xins = xs - xsb;
-	double yins = ys - ysb;
-	double zins = zs - zsb;
-	double wins = ws - wsb;
-
-	/* Sum those together to get a value that determines which region we're in. */
-	double inSum = xins + yins + zins + wins;
-
-	/* Positions relative to origin point. */
-	double dx0 = x - xb;
-	double dy0 = y - yb;
-	double dz0 = z - zb;
-	double dw0 = w - wb;
-
-	/* We'll be defining these inside the next block and using them afterwards. */
-	double dx_ext0, dy_ext0, dz_ext0, dw_ext0;
-	double dx_ext1, dy_ext1, dz_ext1, dw_ext1;
-	double dx_ext2, dy_ext2, dz_ext2, dw_ext2;
-	int xsv_ext0, ysv_ext0, zsv_ext0, wsv_ext0;
-	int xsv_ext1, ysv_ext1, zsv_ext1, wsv_ext1;
-	int xsv_ext2, ysv_ext2, zsv_ext2, wsv_ext2;
-
-	double value = 0;
-	if (inSum <= 1) { /* We're inside the pentachoron (4-Simplex) at (0,0,0,0) */
-
-		/* Determine which two of (0,0,0,1), (0,0,1,0), (0,1,0,0), (1,0,0,0) are closest. */
-		aPoint = 0x01;
-		aScore = xins;
-		bPoint = 0x02;
-		bScore = yins;
-		if (aScore >= bScore && zins > bScore) {
-			bScore = zins;
-			bPoint = 0x04;
-		} else if (aScore < bScore && zins > aScore) {
-			aScore = zins;
-			aPoint = 0x04;
-		}
-		if (aScore >= bScore && wins > bScore) {
-			bScore = wins;
-			bPoint = 0x08;
-		} else if (aScore < bScore && wins > aScore) {
-			aScore = wins;
-			aPoint = 0x08;
-		}
-
-		/* Now we determine the three lattice points not part of the pentachoron that may contribute.
-		   This depends on the closest two pentachoron vertices, including (0,0,0,0) */
-		uins = 1 - inSum;
-		if (uins > aScore || uins > bScore) { /* (0,0,0,0) is one of the closest two pentachoron vertices. */
-			c = (bScore > aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
-			if ((c & 0x01) == 0) {
-				xsv_ext0 = xsb - 1;
-				xsv_ext1 = xsv_ext2 = xsb;
-				dx_ext0 = dx0 + 1;
-				dx_ext1 = dx_ext2 = dx0;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsv_ext2 = xsb + 1;
-				dx_ext0 = dx_ext1 = dx_ext2 = dx0 - 1;
-			}
-
-			if ((c & 0x02) == 0) {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb;
-				dy_ext0 = dy_ext1 = dy_ext2 = dy0;
-				if ((c & 0x01) == 0x01) {
-					ysv_ext0 -= 1;
-					dy_ext0 += 1;
-				} else {
-					ysv_ext1 -= 1;
-					dy_ext1 += 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb + 1;
-				dy_ext0 = dy_ext1 = dy_ext2 = dy0 - 1;
-			}
-
-			if ((c & 0x04) == 0) {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb;
-				dz_ext0 = dz_ext1 = dz_ext2 = dz0;
-				if ((c & 0x03) != 0) {
-					if ((c & 0x03) == 0x03) {
-						zsv_ext0 -= 1;
-						dz_ext0 += 1;
-					} else {
-						zsv_ext1 -= 1;
-						dz_ext1 += 1;
-					}
-				} else {
-					zsv_ext2 -= 1;
-					dz_ext2 += 1;
-				}
-			} else {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb + 1;
-				dz_ext0 = dz_ext1 = dz_ext2 = dz0 - 1;
-			}
-
-			if ((c & 0x08) == 0) {
-				wsv_ext0 = wsv_ext1 = wsb;
-				wsv_ext2 = wsb - 1;
-				dw_ext0 = dw_ext1 = dw0;
-				dw_ext2 = dw0 + 1;
-			} else {
-				wsv_ext0 = wsv_ext1 = wsv_ext2 = wsb + 1;
-				dw_ext0 = dw_ext1 = dw_ext2 = dw0 - 1;
-			}
-		} else { /* (0,0,0,0) is not one of the closest two pentachoron vertices. */
-			c = (int8_t)(aPoint | bPoint); /* Our three extra vertices are determined by the closest two. */
-
-			if ((c & 0x01) == 0) {
-				xsv_ext0 = xsv_ext2 = xsb;
-				xsv_ext1 = xsb - 1;
-				dx_ext0 = dx0 - 2 * SQUISH_CONSTANT_4D;
-				dx_ext1 = dx0 + 1 - SQUISH_CONSTANT_4D;
-				dx_ext2 = dx0 - SQUISH_CONSTANT_4D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsv_ext2 = xsb + 1;
-				dx_ext0 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dx_ext1 = dx_ext2 = dx0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x02) == 0) {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb;
-				dy_ext0 = dy0 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext1 = dy_ext2 = dy0 - SQUISH_CONSTANT_4D;
-				if ((c & 0x01) == 0x01) {
-					ysv_ext1 -= 1;
-					dy_ext1 += 1;
-				} else {
-					ysv_ext2 -= 1;
-					dy_ext2 += 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb + 1;
-				dy_ext0 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext1 = dy_ext2 = dy0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x04) == 0) {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb;
-				dz_ext0 = dz0 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext1 = dz_ext2 = dz0 - SQUISH_CONSTANT_4D;
-				if ((c & 0x03) == 0x03) {
-					zsv_ext1 -= 1;
-					dz_ext1 += 1;
-				} else {
-					zsv_ext2 -= 1;
-					dz_ext2 += 1;
-				}
-			} else {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb + 1;
-				dz_ext0 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext1 = dz_ext2 = dz0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x08) == 0) {
-				wsv_ext0 = wsv_ext1 = wsb;
-				wsv_ext2 = wsb - 1;
-				dw_ext0 = dw0 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext1 = dw0 - SQUISH_CONSTANT_4D;
-				dw_ext2 = dw0 + 1 - SQUISH_CONSTANT_4D;
-			} else {
-				wsv_ext0 = wsv_ext1 = wsv_ext2 = wsb + 1;
-				dw_ext0 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext1 = dw_ext2 = dw0 - 1 - SQUISH_CONSTANT_4D;
-			}
-		}
-
-		/* Contribution (0,0,0,0) */
-		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0 - dw0 * dw0;
-		if (attn0 > 0) {
-			attn0 *= attn0;
-			value += attn0 * attn0 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 0, wsb + 0, dx0, dy0, dz0, dw0);
-		}
-
-		/* Contribution (1,0,0,0) */
-		dx1 = dx0 - 1 - SQUISH_CONSTANT_4D;
-		dy1 = dy0 - 0 - SQUISH_CONSTANT_4D;
-		dz1 = dz0 - 0 - SQUISH_CONSTANT_4D;
-		dw1 = dw0 - 0 - SQUISH_CONSTANT_4D;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1 - dw1 * dw1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 0, wsb + 0, dx1, dy1, dz1, dw1);
-		}
-
-		/* Contribution (0,1,0,0) */
-		dx2 = dx0 - 0 - SQUISH_CONSTANT_4D;
-		dy2 = dy0 - 1 - SQUISH_CONSTANT_4D;
-		dz2 = dz1;
-		dw2 = dw1;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2 - dw2 * dw2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 0, wsb + 0, dx2, dy2, dz2, dw2);
-		}
-
-		/* Contribution (0,0,1,0) */
-		dx3 = dx2;
-		dy3 = dy1;
-		dz3 = dz0 - 1 - SQUISH_CONSTANT_4D;
-		dw3 = dw1;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3 - dw3 * dw3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 1, wsb + 0, dx3, dy3, dz3, dw3);
-		}
-
-		/* Contribution (0,0,0,1) */
-		dx4 = dx2;
-		dy4 = dy1;
-		dz4 = dz1;
-		dw4 = dw0 - 1 - SQUISH_CONSTANT_4D;
-		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4 - dw4 * dw4;
-		if (attn4 > 0) {
-			attn4 *= attn4;
-			value += attn4 * attn4 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 0, wsb + 1, dx4, dy4, dz4, dw4);
-		}
-	} else if (inSum >= 3) { /* We're inside the pentachoron (4-Simplex) at (1,1,1,1)
-		Determine which two of (1,1,1,0), (1,1,0,1), (1,0,1,1), (0,1,1,1) are closest. */
-		aPoint = 0x0E;
-		aScore = xins;
-		bPoint = 0x0D;
-		bScore = yins;
-		if (aScore <= bScore && zins < bScore) {
-			bScore = zins;
-			bPoint = 0x0B;
-		} else if (aScore > bScore && zins < aScore) {
-			aScore = zins;
-			aPoint = 0x0B;
-		}
-		if (aScore <= bScore && wins < bScore) {
-			bScore = wins;
-			bPoint = 0x07;
-		} else if (aScore > bScore && wins < aScore) {
-			aScore = wins;
-			aPoint = 0x07;
-		}
-
-		/* Now we determine the three lattice points not part of the pentachoron that may contribute.
-		   This depends on the closest two pentachoron vertices, including (0,0,0,0) */
-		uins = 4 - inSum;
-		if (uins < aScore || uins < bScore) { /* (1,1,1,1) is one of the closest two pentachoron vertices. */
-			c = (bScore < aScore ? bPoint : aPoint); /* Our other closest vertex is the closest out of a and b. */
-
-			if ((c & 0x01) != 0) {
-				xsv_ext0 = xsb + 2;
-				xsv_ext1 = xsv_ext2 = xsb + 1;
-				dx_ext0 = dx0 - 2 - 4 * SQUISH_CONSTANT_4D;
-				dx_ext1 = dx_ext2 = dx0 - 1 - 4 * SQUISH_CONSTANT_4D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsv_ext2 = xsb;
-				dx_ext0 = dx_ext1 = dx_ext2 = dx0 - 4 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x02) != 0) {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb + 1;
-				dy_ext0 = dy_ext1 = dy_ext2 = dy0 - 1 - 4 * SQUISH_CONSTANT_4D;
-				if ((c & 0x01) != 0) {
-					ysv_ext1 += 1;
-					dy_ext1 -= 1;
-				} else {
-					ysv_ext0 += 1;
-					dy_ext0 -= 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb;
-				dy_ext0 = dy_ext1 = dy_ext2 = dy0 - 4 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x04) != 0) {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb + 1;
-				dz_ext0 = dz_ext1 = dz_ext2 = dz0 - 1 - 4 * SQUISH_CONSTANT_4D;
-				if ((c & 0x03) != 0x03) {
-					if ((c & 0x03) == 0) {
-						zsv_ext0 += 1;
-						dz_ext0 -= 1;
-					} else {
-						zsv_ext1 += 1;
-						dz_ext1 -= 1;
-					}
-				} else {
-					zsv_ext2 += 1;
-					dz_ext2 -= 1;
-				}
-			} else {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb;
-				dz_ext0 = dz_ext1 = dz_ext2 = dz0 - 4 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x08) != 0) {
-				wsv_ext0 = wsv_ext1 = wsb + 1;
-				wsv_ext2 = wsb + 2;
-				dw_ext0 = dw_ext1 = dw0 - 1 - 4 * SQUISH_CONSTANT_4D;
-				dw_ext2 = dw0 - 2 - 4 * SQUISH_CONSTANT_4D;
-			} else {
-				wsv_ext0 = wsv_ext1 = wsv_ext2 = wsb;
-				dw_ext0 = dw_ext1 = dw_ext2 = dw0 - 4 * SQUISH_CONSTANT_4D;
-			}
-		} else { /* (1,1,1,1) is not one of the closest two pentachoron vertices. */
-			c = (int8_t)(aPoint & bPoint); /* Our three extra vertices are determined by the closest two. */
-
-			if ((c & 0x01) != 0) {
-				xsv_ext0 = xsv_ext2 = xsb + 1;
-				xsv_ext1 = xsb + 2;
-				dx_ext0 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dx_ext1 = dx0 - 2 - 3 * SQUISH_CONSTANT_4D;
-				dx_ext2 = dx0 - 1 - 3 * SQUISH_CONSTANT_4D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsv_ext2 = xsb;
-				dx_ext0 = dx0 - 2 * SQUISH_CONSTANT_4D;
-				dx_ext1 = dx_ext2 = dx0 - 3 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x02) != 0) {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb + 1;
-				dy_ext0 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext1 = dy_ext2 = dy0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				if ((c & 0x01) != 0) {
-					ysv_ext2 += 1;
-					dy_ext2 -= 1;
-				} else {
-					ysv_ext1 += 1;
-					dy_ext1 -= 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysv_ext2 = ysb;
-				dy_ext0 = dy0 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext1 = dy_ext2 = dy0 - 3 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x04) != 0) {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb + 1;
-				dz_ext0 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext1 = dz_ext2 = dz0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				if ((c & 0x03) != 0) {
-					zsv_ext2 += 1;
-					dz_ext2 -= 1;
-				} else {
-					zsv_ext1 += 1;
-					dz_ext1 -= 1;
-				}
-			} else {
-				zsv_ext0 = zsv_ext1 = zsv_ext2 = zsb;
-				dz_ext0 = dz0 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext1 = dz_ext2 = dz0 - 3 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c & 0x08) != 0) {
-				wsv_ext0 = wsv_ext1 = wsb + 1;
-				wsv_ext2 = wsb + 2;
-				dw_ext0 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext1 = dw0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				dw_ext2 = dw0 - 2 - 3 * SQUISH_CONSTANT_4D;
-			} else {
-				wsv_ext0 = wsv_ext1 = wsv_ext2 = wsb;
-				dw_ext0 = dw0 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext1 = dw_ext2 = dw0 - 3 * SQUISH_CONSTANT_4D;
-			}
-		}
-
-		/* Contribution (1,1,1,0) */
-		dx4 = dx0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		dy4 = dy0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		dz4 = dz0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		dw4 = dw0 - 3 * SQUISH_CONSTANT_4D;
-		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4 - dw4 * dw4;
-		if (attn4 > 0) {
-			attn4 *= attn4;
-			value += attn4 * attn4 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 1, wsb + 0, dx4, dy4, dz4, dw4);
-		}
-
-		/* Contribution (1,1,0,1) */
-		dx3 = dx4;
-		dy3 = dy4;
-		dz3 = dz0 - 3 * SQUISH_CONSTANT_4D;
-		dw3 = dw0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3 - dw3 * dw3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 0, wsb + 1, dx3, dy3, dz3, dw3);
-		}
-
-		/* Contribution (1,0,1,1) */
-		dx2 = dx4;
-		dy2 = dy0 - 3 * SQUISH_CONSTANT_4D;
-		dz2 = dz4;
-		dw2 = dw3;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2 - dw2 * dw2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 1, wsb + 1, dx2, dy2, dz2, dw2);
-		}
-
-		/* Contribution (0,1,1,1) */
-		dx1 = dx0 - 3 * SQUISH_CONSTANT_4D;
-		dz1 = dz4;
-		dy1 = dy4;
-		dw1 = dw3;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1 - dw1 * dw1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 1, wsb + 1, dx1, dy1, dz1, dw1);
-		}
-
-		/* Contribution (1,1,1,1) */
-		dx0 = dx0 - 1 - 4 * SQUISH_CONSTANT_4D;
-		dy0 = dy0 - 1 - 4 * SQUISH_CONSTANT_4D;
-		dz0 = dz0 - 1 - 4 * SQUISH_CONSTANT_4D;
-		dw0 = dw0 - 1 - 4 * SQUISH_CONSTANT_4D;
-		attn0 = 2 - dx0 * dx0 - dy0 * dy0 - dz0 * dz0 - dw0 * dw0;
-		if (attn0 > 0) {
-			attn0 *= attn0;
-			value += attn0 * attn0 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 1, wsb + 1, dx0, dy0, dz0, dw0);
-		}
-	} else if (inSum <= 2) { /* We're inside the first dispentachoron (Rectified 4-Simplex) */
-		aIsBiggerSide = 1;
-		bIsBiggerSide = 1;
-
-		/* Decide between (1,1,0,0) and (0,0,1,1) */
-		if (xins + yins > zins + wins) {
-			aScore = xins + yins;
-			aPoint = 0x03;
-		} else {
-			aScore = zins + wins;
-			aPoint = 0x0C;
-		}
-
-		/* Decide between (1,0,1,0) and (0,1,0,1) */
-		if (xins + zins > yins + wins) {
-			bScore = xins + zins;
-			bPoint = 0x05;
-		} else {
-			bScore = yins + wins;
-			bPoint = 0x0A;
-		}
-
-		/* Closer between (1,0,0,1) and (0,1,1,0) will replace the further of a and b, if closer. */
-		if (xins + wins > yins + zins) {
-			score = xins + wins;
-			if (aScore >= bScore && score > bScore) {
-				bScore = score;
-				bPoint = 0x09;
-			} else if (aScore < bScore && score > aScore) {
-				aScore = score;
-				aPoint = 0x09;
-			}
-		} else {
-			score = yins + zins;
-			if (aScore >= bScore && score > bScore) {
-				bScore = score;
-				bPoint = 0x06;
-			} else if (aScore < bScore && score > aScore) {
-				aScore = score;
-				aPoint = 0x06;
-			}
-		}
-
-		/* Decide if (1,0,0,0) is closer. */
-		p1 = 2 - inSum + xins;
-		if (aScore >= bScore && p1 > bScore) {
-			bScore = p1;
-			bPoint = 0x01;
-			bIsBiggerSide = 0;
-		} else if (aScore < bScore && p1 > aScore) {
-			aScore = p1;
-			aPoint = 0x01;
-			aIsBiggerSide = 0;
-		}
-
-		/* Decide if (0,1,0,0) is closer. */
-		p2 = 2 - inSum + yins;
-		if (aScore >= bScore && p2 > bScore) {
-			bScore = p2;
-			bPoint = 0x02;
-			bIsBiggerSide = 0;
-		} else if (aScore < bScore && p2 > aScore) {
-			aScore = p2;
-			aPoint = 0x02;
-			aIsBiggerSide = 0;
-		}
-
-		/* Decide if (0,0,1,0) is closer. */
-		p3 = 2 - inSum + zins;
-		if (aScore >= bScore && p3 > bScore) {
-			bScore = p3;
-			bPoint = 0x04;
-			bIsBiggerSide = 0;
-		} else if (aScore < bScore && p3 > aScore) {
-			aScore = p3;
-			aPoint = 0x04;
-			aIsBiggerSide = 0;
-		}
-
-		/* Decide if (0,0,0,1) is closer. */
-		p4 = 2 - inSum + wins;
-		if (aScore >= bScore && p4 > bScore) {
-			bScore = p4;
-			bPoint = 0x08;
-			bIsBiggerSide = 0;
-		} else if (aScore < bScore && p4 > aScore) {
-			aScore = p4;
-			aPoint = 0x08;
-			aIsBiggerSide = 0;
-		}
-
-		/* Where each of the two closest points are determines how the extra three vertices are calculated. */
-		if (aIsBiggerSide == bIsBiggerSide) {
-			if (aIsBiggerSide) { /* Both closest points on the bigger side */
-				c1 = (int8_t)(aPoint | bPoint);
-				c2 = (int8_t)(aPoint & bPoint);
-				if ((c1 & 0x01) == 0) {
-					xsv_ext0 = xsb;
-					xsv_ext1 = xsb - 1;
-					dx_ext0 = dx0 - 3 * SQUISH_CONSTANT_4D;
-					dx_ext1 = dx0 + 1 - 2 * SQUISH_CONSTANT_4D;
-				} else {
-					xsv_ext0 = xsv_ext1 = xsb + 1;
-					dx_ext0 = dx0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					dx_ext1 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				}
-
-				if ((c1 & 0x02) == 0) {
-					ysv_ext0 = ysb;
-					ysv_ext1 = ysb - 1;
-					dy_ext0 = dy0 - 3 * SQUISH_CONSTANT_4D;
-					dy_ext1 = dy0 + 1 - 2 * SQUISH_CONSTANT_4D;
-				} else {
-					ysv_ext0 = ysv_ext1 = ysb + 1;
-					dy_ext0 = dy0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					dy_ext1 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				}
-
-				if ((c1 & 0x04) == 0) {
-					zsv_ext0 = zsb;
-					zsv_ext1 = zsb - 1;
-					dz_ext0 = dz0 - 3 * SQUISH_CONSTANT_4D;
-					dz_ext1 = dz0 + 1 - 2 * SQUISH_CONSTANT_4D;
-				} else {
-					zsv_ext0 = zsv_ext1 = zsb + 1;
-					dz_ext0 = dz0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					dz_ext1 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				}
-
-				if ((c1 & 0x08) == 0) {
-					wsv_ext0 = wsb;
-					wsv_ext1 = wsb - 1;
-					dw_ext0 = dw0 - 3 * SQUISH_CONSTANT_4D;
-					dw_ext1 = dw0 + 1 - 2 * SQUISH_CONSTANT_4D;
-				} else {
-					wsv_ext0 = wsv_ext1 = wsb + 1;
-					dw_ext0 = dw0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					dw_ext1 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				}
-
-				/* One combination is a permutation of (0,0,0,2) based on c2 */
-				xsv_ext2 = xsb;
-				ysv_ext2 = ysb;
-				zsv_ext2 = zsb;
-				wsv_ext2 = wsb;
-				dx_ext2 = dx0 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext2 = dy0 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext2 = dz0 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext2 = dw0 - 2 * SQUISH_CONSTANT_4D;
-				if ((c2 & 0x01) != 0) {
-					xsv_ext2 += 2;
-					dx_ext2 -= 2;
-				} else if ((c2 & 0x02) != 0) {
-					ysv_ext2 += 2;
-					dy_ext2 -= 2;
-				} else if ((c2 & 0x04) != 0) {
-					zsv_ext2 += 2;
-					dz_ext2 -= 2;
-				} else {
-					wsv_ext2 += 2;
-					dw_ext2 -= 2;
-				}
-
-			} else { /* Both closest points on the smaller side */
-				/* One of the two extra points is (0,0,0,0) */
-				xsv_ext2 = xsb;
-				ysv_ext2 = ysb;
-				zsv_ext2 = zsb;
-				wsv_ext2 = wsb;
-				dx_ext2 = dx0;
-				dy_ext2 = dy0;
-				dz_ext2 = dz0;
-				dw_ext2 = dw0;
-
-				/* Other two points are based on the omitted axes. */
-				c = (int8_t)(aPoint | bPoint);
-
-				if ((c & 0x01) == 0) {
-					xsv_ext0 = xsb - 1;
-					xsv_ext1 = xsb;
-					dx_ext0 = dx0 + 1 - SQUISH_CONSTANT_4D;
-					dx_ext1 = dx0 - SQUISH_CONSTANT_4D;
-				} else {
-					xsv_ext0 = xsv_ext1 = xsb + 1;
-					dx_ext0 = dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_4D;
-				}
-
-				if ((c & 0x02) == 0) {
-					ysv_ext0 = ysv_ext1 = ysb;
-					dy_ext0 = dy_ext1 = dy0 - SQUISH_CONSTANT_4D;
-					if ((c & 0x01) == 0x01)
-					{
-						ysv_ext0 -= 1;
-						dy_ext0 += 1;
-					} else {
-						ysv_ext1 -= 1;
-						dy_ext1 += 1;
-					}
-				} else {
-					ysv_ext0 = ysv_ext1 = ysb + 1;
-					dy_ext0 = dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_4D;
-				}
-
-				if ((c & 0x04) == 0) {
-					zsv_ext0 = zsv_ext1 = zsb;
-					dz_ext0 = dz_ext1 = dz0 - SQUISH_CONSTANT_4D;
-					if ((c & 0x03) == 0x03)
-					{
-						zsv_ext0 -= 1;
-						dz_ext0 += 1;
-					} else {
-						zsv_ext1 -= 1;
-						dz_ext1 += 1;
-					}
-				} else {
-					zsv_ext0 = zsv_ext1 = zsb + 1;
-					dz_ext0 = dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_4D;
-				}
-
-				if ((c & 0x08) == 0)
-				{
-					wsv_ext0 = wsb;
-					wsv_ext1 = wsb - 1;
-					dw_ext0 = dw0 - SQUISH_CONSTANT_4D;
-					dw_ext1 = dw0 + 1 - SQUISH_CONSTANT_4D;
-				} else {
-					wsv_ext0 = wsv_ext1 = wsb + 1;
-					dw_ext0 = dw_ext1 = dw0 - 1 - SQUISH_CONSTANT_4D;
-				}
-
-			}
-		} else { /* One point on each "side" */
-			if (aIsBiggerSide) {
-				c1 = aPoint;
-				c2 = bPoint;
-			} else {
-				c1 = bPoint;
-				c2 = aPoint;
-			}
-
-			/* Two contributions are the bigger-sided point with each 0 replaced with -1. */
-			if ((c1 & 0x01) == 0) {
-				xsv_ext0 = xsb - 1;
-				xsv_ext1 = xsb;
-				dx_ext0 = dx0 + 1 - SQUISH_CONSTANT_4D;
-				dx_ext1 = dx0 - SQUISH_CONSTANT_4D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsb + 1;
-				dx_ext0 = dx_ext1 = dx0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			if ((c1 & 0x02) == 0) {
-				ysv_ext0 = ysv_ext1 = ysb;
-				dy_ext0 = dy_ext1 = dy0 - SQUISH_CONSTANT_4D;
-				if ((c1 & 0x01) == 0x01) {
-					ysv_ext0 -= 1;
-					dy_ext0 += 1;
-				} else {
-					ysv_ext1 -= 1;
-					dy_ext1 += 1;
-				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysb + 1;
-				dy_ext0 = dy_ext1 = dy0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			if ((c1 & 0x04) == 0) {
-				zsv_ext0 = zsv_ext1 = zsb;
-				dz_ext0 = dz_ext1 = dz0 - SQUISH_CONSTANT_4D;
-				if ((c1 & 0x03) == 0x03) {
-					zsv_ext0 -= 1;
-					dz_ext0 += 1;
-				} else {
-					zsv_ext1 -= 1;
-					dz_ext1 += 1;
-				}
-			} else {
-				zsv_ext0 = zsv_ext1 = zsb + 1;
-				dz_ext0 = dz_ext1 = dz0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			if ((c1 & 0x08) == 0) {
-				wsv_ext0 = wsb;
-				wsv_ext1 = wsb - 1;
-				dw_ext0 = dw0 - SQUISH_CONSTANT_4D;
-				dw_ext1 = dw0 + 1 - SQUISH_CONSTANT_4D;
-			} else {
-				wsv_ext0 = wsv_ext1 = wsb + 1;
-				dw_ext0 = dw_ext1 = dw0 - 1 - SQUISH_CONSTANT_4D;
-			}
-
-			/* One contribution is a permutation of (0,0,0,2) based on the smaller-sided point */
-			xsv_ext2 = xsb;
-			ysv_ext2 = ysb;
-			zsv_ext2 = zsb;
-			wsv_ext2 = wsb;
-			dx_ext2 = dx0 - 2 * SQUISH_CONSTANT_4D;
-			dy_ext2 = dy0 - 2 * SQUISH_CONSTANT_4D;
-			dz_ext2 = dz0 - 2 * SQUISH_CONSTANT_4D;
-			dw_ext2 = dw0 - 2 * SQUISH_CONSTANT_4D;
-			if ((c2 & 0x01) != 0) {
-				xsv_ext2 += 2;
-				dx_ext2 -= 2;
-			} else if ((c2 & 0x02) != 0) {
-				ysv_ext2 += 2;
-				dy_ext2 -= 2;
-			} else if ((c2 & 0x04) != 0) {
-				zsv_ext2 += 2;
-				dz_ext2 -= 2;
-			} else {
-				wsv_ext2 += 2;
-				dw_ext2 -= 2;
-			}
-		}
-
-		/* Contribution (1,0,0,0) */
-		dx1 = dx0 - 1 - SQUISH_CONSTANT_4D;
-		dy1 = dy0 - 0 - SQUISH_CONSTANT_4D;
-		dz1 = dz0 - 0 - SQUISH_CONSTANT_4D;
-		dw1 = dw0 - 0 - SQUISH_CONSTANT_4D;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1 - dw1 * dw1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 0, wsb + 0, dx1, dy1, dz1, dw1);
-		}
-
-		/* Contribution (0,1,0,0) */
-		dx2 = dx0 - 0 - SQUISH_CONSTANT_4D;
-		dy2 = dy0 - 1 - SQUISH_CONSTANT_4D;
-		dz2 = dz1;
-		dw2 = dw1;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2 - dw2 * dw2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 0, wsb + 0, dx2, dy2, dz2, dw2);
-		}
-
-		/* Contribution (0,0,1,0) */
-		dx3 = dx2;
-		dy3 = dy1;
-		dz3 = dz0 - 1 - SQUISH_CONSTANT_4D;
-		dw3 = dw1;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3 - dw3 * dw3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 1, wsb + 0, dx3, dy3, dz3, dw3);
-		}
-
-		/* Contribution (0,0,0,1) */
-		dx4 = dx2;
-		dy4 = dy1;
-		dz4 = dz1;
-		dw4 = dw0 - 1 - SQUISH_CONSTANT_4D;
-		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4 - dw4 * dw4;
-		if (attn4 > 0) {
-			attn4 *= attn4;
-			value += attn4 * attn4 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 0, wsb + 1, dx4, dy4, dz4, dw4);
-		}
-
-		/* Contribution (1,1,0,0) */
-		dx5 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dy5 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dz5 = dz0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dw5 = dw0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		attn5 = 2 - dx5 * dx5 - dy5 * dy5 - dz5 * dz5 - dw5 * dw5;
-		if (attn5 > 0) {
-			attn5 *= attn5;
-			value += attn5 * attn5 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 0, wsb + 0, dx5, dy5, dz5, dw5);
-		}
-
-		/* Contribution (1,0,1,0) */
-		dx6 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dy6 = dy0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dz6 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dw6 = dw0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		attn6 = 2 - dx6 * dx6 - dy6 * dy6 - dz6 * dz6 - dw6 * dw6;
-		if (attn6 > 0) {
-			attn6 *= attn6;
-			value += attn6 * attn6 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 1, wsb + 0, dx6, dy6, dz6, dw6);
-		}
-
-		/* Contribution (1,0,0,1) */
-		dx7 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dy7 = dy0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dz7 = dz0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dw7 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		attn7 = 2 - dx7 * dx7 - dy7 * dy7 - dz7 * dz7 - dw7 * dw7;
-		if (attn7 > 0) {
-			attn7 *= attn7;
-			value += attn7 * attn7 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 0, wsb + 1, dx7, dy7, dz7, dw7);
-		}
-
-		/* Contribution (0,1,1,0) */
-		dx8 = dx0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dy8 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dz8 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dw8 = dw0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		attn8 = 2 - dx8 * dx8 - dy8 * dy8 - dz8 * dz8 - dw8 * dw8;
-		if (attn8 > 0) {
-			attn8 *= attn8;
-			value += attn8 * attn8 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 1, wsb + 0, dx8, dy8, dz8, dw8);
-		}
-
-		/* Contribution (0,1,0,1) */
-		dx9 = dx0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dy9 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dz9 = dz0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dw9 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		attn9 = 2 - dx9 * dx9 - dy9 * dy9 - dz9 * dz9 - dw9 * dw9;
-		if (attn9 > 0) {
-			attn9 *= attn9;
-			value += attn9 * attn9 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 0, wsb + 1, dx9, dy9, dz9, dw9);
-		}
-
-		/* Contribution (0,0,1,1) */
-		dx10 = dx0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dy10 = dy0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dz10 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dw10 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		attn10 = 2 - dx10 * dx10 - dy10 * dy10 - dz10 * dz10 - dw10 * dw10;
-		if (attn10 > 0) {
-			attn10 *= attn10;
-			value += attn10 * attn10 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 1, wsb + 1, dx10, dy10, dz10, dw10);
-		}
-	} else { /* We're inside the second dispentachoron (Rectified 4-Simplex) */
-		aIsBiggerSide = 1;
-		bIsBiggerSide = 1;
-
-		/* Decide between (0,0,1,1) and (1,1,0,0) */
-		if (xins + yins < zins + wins) {
-			aScore = xins + yins;
-			aPoint = 0x0C;
-		} else {
-			aScore = zins + wins;
-			aPoint = 0x03;
-		}
-
-		/* Decide between (0,1,0,1) and (1,0,1,0) */
-		if (xins + zins < yins + wins) {
-			bScore = xins + zins;
-			bPoint = 0x0A;
-		} else {
-			bScore = yins + wins;
-			bPoint = 0x05;
-		}
-
-		/* Closer between (0,1,1,0) and (1,0,0,1) will replace the further of a and b, if closer. */
-		if (xins + wins < yins + zins) {
-			score = xins + wins;
-			if (aScore <= bScore && score < bScore) {
-				bScore = score;
-				bPoint = 0x06;
-			} else if (aScore > bScore && score < aScore) {
-				aScore = score;
-				aPoint = 0x06;
-			}
-		} else {
-			score = yins + zins;
-			if (aScore <= bScore && score < bScore) {
-				bScore = score;
-				bPoint = 0x09;
-			} else if (aScore > bScore && score < aScore) {
-				aScore = score;
-				aPoint = 0x09;
-			}
-		}
-
-		/* Decide if (0,1,1,1) is closer. */
-		p1 = 3 - inSum + xins;
-		if (aScore <= bScore && p1 < bScore) {
-			bScore = p1;
-			bPoint = 0x0E;
-			bIsBiggerSide = 0;
-		} else if (aScore > bScore && p1 < aScore) {
-			aScore = p1;
-			aPoint = 0x0E;
-			aIsBiggerSide = 0;
-		}
-
-		/* Decide if (1,0,1,1) is closer. */
-		p2 = 3 - inSum + yins;
-		if (aScore <= bScore && p2 < bScore) {
-			bScore = p2;
-			bPoint = 0x0D;
-			bIsBiggerSide = 0;
-		} else if (aScore > bScore && p2 < aScore) {
-			aScore = p2;
-			aPoint = 0x0D;
-			aIsBiggerSide = 0;
-		}
-
-		/* Decide if (1,1,0,1) is closer. */
-		p3 = 3 - inSum + zins;
-		if (aScore <= bScore && p3 < bScore) {
-			bScore = p3;
-			bPoint = 0x0B;
-			bIsBiggerSide = 0;
-		} else if (aScore > bScore && p3 < aScore) {
-			aScore = p3;
-			aPoint = 0x0B;
-			aIsBiggerSide = 0;
-		}
-
-		/* Decide if (1,1,1,0) is closer. */
-		p4 = 3 - inSum + wins;
-		if (aScore <= bScore && p4 < bScore) {
-			bScore = p4;
-			bPoint = 0x07;
-			bIsBiggerSide = 0;
-		} else if (aScore > bScore && p4 < aScore) {
-			aScore = p4;
-			aPoint = 0x07;
-			aIsBiggerSide = 0;
+	const int16_t *perm = ctx->perm;
+	const int16_t *permGradIndex3D = ctx->permGradIndex3D;
+	double smin[3] = { INFINITY, INFINITY, INFINITY };
+	double smax[3] = { -INFINITY, -INFINITY, -INFINITY };
+	double box[2][3] = { { x0, y0, z0 }, { x1, y1, z1 } };
+	double vlo = 0, vhi = 0;
+	int i, a, xsv, ysv, zsv;
+
+	/* range of super-cells touched by the box, in stretched coordinates */
+	for (i = 0; i < 8; i++) {
+		double x = box[i >> 2 & 1][0], y = box[i >> 1 & 1][1], z = box[i & 1][2];
+		double stretchOffset = (x + y + z) * STRETCH_CONSTANT_3D;
+		double s[3] = { x + stretchOffset, y + stretchOffset, z + stretchOffset };
+		for (a = 0; a < 3; a++) {
+			smin[a] = fmin(smin[a], s[a]);
+			smax[a] = fmax(smax[a], s[a]);
 		}
+	}
 
-		/* Where each of the two closest points are determines how the extra three vertices are calculated. */
-		if (aIsBiggerSide == bIsBiggerSide) {
-			if (aIsBiggerSide) { /* Both closest points on the bigger side */
-				c1 = (int8_t)(aPoint & bPoint);
-				c2 = (int8_t)(aPoint | bPoint);
-
-				/* Two contributions are permutations of (0,0,0,1) and (0,0,0,2) based on c1 */
-				xsv_ext0 = xsv_ext1 = xsb;
-				ysv_ext0 = ysv_ext1 = ysb;
-				zsv_ext0 = zsv_ext1 = zsb;
-				wsv_ext0 = wsv_ext1 = wsb;
-				dx_ext0 = dx0 - SQUISH_CONSTANT_4D;
-				dy_ext0 = dy0 - SQUISH_CONSTANT_4D;
-				dz_ext0 = dz0 - SQUISH_CONSTANT_4D;
-				dw_ext0 = dw0 - SQUISH_CONSTANT_4D;
-				dx_ext1 = dx0 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext1 = dy0 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext1 = dz0 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext1 = dw0 - 2 * SQUISH_CONSTANT_4D;
-				if ((c1 & 0x01) != 0) {
-					xsv_ext0 += 1;
-					dx_ext0 -= 1;
-					xsv_ext1 += 2;
-					dx_ext1 -= 2;
-				} else if ((c1 & 0x02) != 0) {
-					ysv_ext0 += 1;
-					dy_ext0 -= 1;
-					ysv_ext1 += 2;
-					dy_ext1 -= 2;
-				} else if ((c1 & 0x04) != 0) {
-					zsv_ext0 += 1;
-					dz_ext0 -= 1;
-					zsv_ext1 += 2;
-					dz_ext1 -= 2;
-				} else {
-					wsv_ext0 += 1;
-					dw_ext0 -= 1;
-					wsv_ext1 += 2;
-					dw_ext1 -= 2;
-				}
-
-				/* One contribution is a permutation of (1,1,1,-1) based on c2 */
-				xsv_ext2 = xsb + 1;
-				ysv_ext2 = ysb + 1;
-				zsv_ext2 = zsb + 1;
-				wsv_ext2 = wsb + 1;
-				dx_ext2 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dy_ext2 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dz_ext2 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				dw_ext2 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-				if ((c2 & 0x01) == 0) {
-					xsv_ext2 -= 2;
-					dx_ext2 += 2;
-				} else if ((c2 & 0x02) == 0) {
-					ysv_ext2 -= 2;
-					dy_ext2 += 2;
-				} else if ((c2 & 0x04) == 0) {
-					zsv_ext2 -= 2;
-					dz_ext2 += 2;
-				} else {
-					wsv_ext2 -= 2;
-					dw_ext2 += 2;
-				}
-			} else { /* Both closest points on the smaller side */
-				/* One of the two extra points is (1,1,1,1) */
-				xsv_ext2 = xsb + 1;
-				ysv_ext2 = ysb + 1;
-				zsv_ext2 = zsb + 1;
-				wsv_ext2 = wsb + 1;
-				dx_ext2 = dx0 - 1 - 4 * SQUISH_CONSTANT_4D;
-				dy_ext2 = dy0 - 1 - 4 * SQUISH_CONSTANT_4D;
-				dz_ext2 = dz0 - 1 - 4 * SQUISH_CONSTANT_4D;
-				dw_ext2 = dw0 - 1 - 4 * SQUISH_CONSTANT_4D;
-
-				/* Other two points are based on the shared axes. */
-				c = (int8_t)(aPoint & bPoint);
-
-				if ((c & 0x01) != 0) {
-					xsv_ext0 = xsb + 2;
-					xsv_ext1 = xsb + 1;
-					dx_ext0 = dx0 - 2 - 3 * SQUISH_CONSTANT_4D;
-					dx_ext1 = dx0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				} else {
-					xsv_ext0 = xsv_ext1 = xsb;
-					dx_ext0 = dx_ext1 = dx0 - 3 * SQUISH_CONSTANT_4D;
-				}
-
-				if ((c & 0x02) != 0) {
-					ysv_ext0 = ysv_ext1 = ysb + 1;
-					dy_ext0 = dy_ext1 = dy0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					if ((c & 0x01) == 0)
-					{
-						ysv_ext0 += 1;
-						dy_ext0 -= 1;
-					} else {
-						ysv_ext1 += 1;
-						dy_ext1 -= 1;
-					}
-				} else {
-					ysv_ext0 = ysv_ext1 = ysb;
-					dy_ext0 = dy_ext1 = dy0 - 3 * SQUISH_CONSTANT_4D;
-				}
-
-				if ((c & 0x04) != 0) {
-					zsv_ext0 = zsv_ext1 = zsb + 1;
-					dz_ext0 = dz_ext1 = dz0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					if ((c & 0x03) == 0)
-					{
-						zsv_ext0 += 1;
-						dz_ext0 -= 1;
-					} else {
-						zsv_ext1 += 1;
-						dz_ext1 -= 1;
-					}
-				} else {
-					zsv_ext0 = zsv_ext1 = zsb;
-					dz_ext0 = dz_ext1 = dz0 - 3 * SQUISH_CONSTANT_4D;
-				}
-
-				if ((c & 0x08) != 0)
-				{
-					wsv_ext0 = wsb + 1;
-					wsv_ext1 = wsb + 2;
-					dw_ext0 = dw0 - 1 - 3 * SQUISH_CONSTANT_4D;
-					dw_ext1 = dw0 - 2 - 3 * SQUISH_CONSTANT_4D;
-				} else {
-					wsv_ext0 = wsv_ext1 = wsb;
-					dw_ext0 = dw_ext1 = dw0 - 3 * SQUISH_CONSTANT_4D;
-				}
-			}
-		} else { /* One point on each "side" */
-			if (aIsBiggerSide) {
-				c1 = aPoint;
-				c2 = bPoint;
-			} else {
-				c1 = bPoint;
-				c2 = aPoint;
-			}
-
-			/* Two contributions are the bigger-sided point with each 1 replaced with 2. */
-			if ((c1 & 0x01) != 0) {
-				xsv_ext0 = xsb + 2;
-				xsv_ext1 = xsb + 1;
-				dx_ext0 = dx0 - 2 - 3 * SQUISH_CONSTANT_4D;
-				dx_ext1 = dx0 - 1 - 3 * SQUISH_CONSTANT_4D;
-			} else {
-				xsv_ext0 = xsv_ext1 = xsb;
-				dx_ext0 = dx_ext1 = dx0 - 3 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c1 & 0x02) != 0) {
-				ysv_ext0 = ysv_ext1 = ysb + 1;
-				dy_ext0 = dy_ext1 = dy0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				if ((c1 & 0x01) == 0) {
-					ysv_ext0 += 1;
-					dy_ext0 -= 1;
-				} else {
-					ysv_ext1 += 1;
-					dy_ext1 -= 1;
+	/* the kernel radius is sqrt(2) and stretching never lengthens a vector,
+	 * so no vertex further than that along any stretched axis can reach */
+	for (xsv = fastFloor(smin[0] - 1.5); xsv <= fastFloor(smax[0] + 1.5); xsv++) {
+		for (ysv = fastFloor(smin[1] - 1.5); ysv <= fastFloor(smax[1] + 1.5); ysv++) {
+			for (zsv = fastFloor(smin[2] - 1.5); zsv <= fastFloor(smax[2] + 1.5); zsv++) {
+				double squishOffset = (xsv + ysv + zsv) * SQUISH_CONSTANT_3D;
+				double v[3] = { xsv + squishOffset, ysv + squishOffset, zsv + squishOffset };
+				double near2 = 0, far2 = 0;
+				double glo = 0, ghi = 0;
+				double attnMin, attnMax;
+				int index;
+
+				for (a = 0; a < 3; a++) {
+					double d0 = box[0][a] - v[a];
+					double d1 = box[1][a] - v[a];
+					double dnear = d0 > 0 ? d0 : (d1 < 0 ? -d1 : 0);
+					double dfar = fmax(fabs(d0), fabs(d1));
+					near2 += dnear * dnear;
+					far2 += dfar * dfar;
 				}
-			} else {
-				ysv_ext0 = ysv_ext1 = ysb;
-				dy_ext0 = dy_ext1 = dy0 - 3 * SQUISH_CONSTANT_4D;
-			}
-
-			if ((c1 & 0x04) != 0) {
-				zsv_ext0 = zsv_ext1 = zsb + 1;
-				dz_ext0 = dz_ext1 = dz0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				if ((c1 & 0x03) == 0) {
-					zsv_ext0 += 1;
-					dz_ext0 -= 1;
-				} else {
-					zsv_ext1 += 1;
-					dz_ext1 -= 1;
+				if (near2 >= 2)
+					continue;
+
+				index = permGradIndex3D[(perm[(perm[xsv & 0xFF] + ysv) & 0xFF] + zsv) & 0xFF];
+				for (a = 0; a < 3; a++) {
+					double g = gradients3D[index + a];
+					double d0 = box[0][a] - v[a];
+					double d1 = box[1][a] - v[a];
+					glo += g * (g > 0 ? d0 : d1);
+					ghi += g * (g > 0 ? d1 : d0);
 				}
-			} else {
-				zsv_ext0 = zsv_ext1 = zsb;
-				dz_ext0 = dz_ext1 = dz0 - 3 * SQUISH_CONSTANT_4D;
-			}
 
-			if ((c1 & 0x08) != 0) {
-				wsv_ext0 = wsb + 1;
-				wsv_ext1 = wsb + 2;
-				dw_ext0 = dw0 - 1 - 3 * SQUISH_CONSTANT_4D;
-				dw_ext1 = dw0 - 2 - 3 * SQUISH_CONSTANT_4D;
-			} else {
-				wsv_ext0 = wsv_ext1 = wsb;
-				dw_ext0 = dw_ext1 = dw0 - 3 * SQUISH_CONSTANT_4D;
-			}
+				attnMax = 2 - near2;
+				attnMin = far2 < 2 ? 2 - far2 : 0;
+				attnMax *= attnMax;
+				attnMax *= attnMax;
+				attnMin *= attnMin;
+				attnMin *= attnMin;
 
-			/* One contribution is a permutation of (1,1,1,-1) based on the smaller-sided point */
-			xsv_ext2 = xsb + 1;
-			ysv_ext2 = ysb + 1;
-			zsv_ext2 = zsb + 1;
-			wsv_ext2 = wsb + 1;
-			dx_ext2 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-			dy_ext2 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-			dz_ext2 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-			dw_ext2 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-			if ((c2 & 0x01) == 0) {
-				xsv_ext2 -= 2;
-				dx_ext2 += 2;
-			} else if ((c2 & 0x02) == 0) {
-				ysv_ext2 -= 2;
-				dy_ext2 += 2;
-			} else if ((c2 & 0x04) == 0) {
-				zsv_ext2 -= 2;
-				dz_ext2 += 2;
-			} else {
-				wsv_ext2 -= 2;
-				dw_ext2 += 2;
+				vlo += glo * (glo < 0 ? attnMax : attnMin);
+				vhi += ghi * (ghi > 0 ? attnMax : attnMin);
 			}
 		}
-
-		/* Contribution (1,1,1,0) */
-		dx4 = dx0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		dy4 = dy0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		dz4 = dz0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		dw4 = dw0 - 3 * SQUISH_CONSTANT_4D;
-		attn4 = 2 - dx4 * dx4 - dy4 * dy4 - dz4 * dz4 - dw4 * dw4;
-		if (attn4 > 0) {
-			attn4 *= attn4;
-			value += attn4 * attn4 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 1, wsb + 0, dx4, dy4, dz4, dw4);
-		}
-
-		/* Contribution (1,1,0,1) */
-		dx3 = dx4;
-		dy3 = dy4;
-		dz3 = dz0 - 3 * SQUISH_CONSTANT_4D;
-		dw3 = dw0 - 1 - 3 * SQUISH_CONSTANT_4D;
-		attn3 = 2 - dx3 * dx3 - dy3 * dy3 - dz3 * dz3 - dw3 * dw3;
-		if (attn3 > 0) {
-			attn3 *= attn3;
-			value += attn3 * attn3 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 0, wsb + 1, dx3, dy3, dz3, dw3);
-		}
-
-		/* Contribution (1,0,1,1) */
-		dx2 = dx4;
-		dy2 = dy0 - 3 * SQUISH_CONSTANT_4D;
-		dz2 = dz4;
-		dw2 = dw3;
-		attn2 = 2 - dx2 * dx2 - dy2 * dy2 - dz2 * dz2 - dw2 * dw2;
-		if (attn2 > 0) {
-			attn2 *= attn2;
-			value += attn2 * attn2 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 1, wsb + 1, dx2, dy2, dz2, dw2);
-		}
-
-		/* Contribution (0,1,1,1) */
-		dx1 = dx0 - 3 * SQUISH_CONSTANT_4D;
-		dz1 = dz4;
-		dy1 = dy4;
-		dw1 = dw3;
-		attn1 = 2 - dx1 * dx1 - dy1 * dy1 - dz1 * dz1 - dw1 * dw1;
-		if (attn1 > 0) {
-			attn1 *= attn1;
-			value += attn1 * attn1 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 1, wsb + 1, dx1, dy1, dz1, dw1);
-		}
-
-		/* Contribution (1,1,0,0) */
-		dx5 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dy5 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dz5 = dz0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dw5 = dw0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		attn5 = 2 - dx5 * dx5 - dy5 * dy5 - dz5 * dz5 - dw5 * dw5;
-		if (attn5 > 0) {
-			attn5 *= attn5;
-			value += attn5 * attn5 * extrapolate4(ctx, xsb + 1, ysb + 1, zsb + 0, wsb + 0, dx5, dy5, dz5, dw5);
-		}
-
-		/* Contribution (1,0,1,0) */
-		dx6 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dy6 = dy0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dz6 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dw6 = dw0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		attn6 = 2 - dx6 * dx6 - dy6 * dy6 - dz6 * dz6 - dw6 * dw6;
-		if (attn6 > 0) {
-			attn6 *= attn6;
-			value += attn6 * attn6 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 1, wsb + 0, dx6, dy6, dz6, dw6);
-		}
-
-		/* Contribution (1,0,0,1) */
-		dx7 = dx0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dy7 = dy0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dz7 = dz0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dw7 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		attn7 = 2 - dx7 * dx7 - dy7 * dy7 - dz7 * dz7 - dw7 * dw7;
-		if (attn7 > 0) {
-			attn7 *= attn7;
-			value += attn7 * attn7 * extrapolate4(ctx, xsb + 1, ysb + 0, zsb + 0, wsb + 1, dx7, dy7, dz7, dw7);
-		}
-
-		/* Contribution (0,1,1,0) */
-		dx8 = dx0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dy8 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dz8 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dw8 = dw0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		attn8 = 2 - dx8 * dx8 - dy8 * dy8 - dz8 * dz8 - dw8 * dw8;
-		if (attn8 > 0) {
-			attn8 *= attn8;
-			value += attn8 * attn8 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 1, wsb + 0, dx8, dy8, dz8, dw8);
-		}
-
-		/* Contribution (0,1,0,1) */
-		dx9 = dx0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dy9 = dy0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dz9 = dz0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dw9 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		attn9 = 2 - dx9 * dx9 - dy9 * dy9 - dz9 * dz9 - dw9 * dw9;
-		if (attn9 > 0) {
-			attn9 *= attn9;
-			value += attn9 * attn9 * extrapolate4(ctx, xsb + 0, ysb + 1, zsb + 0, wsb + 1, dx9, dy9, dz9, dw9);
-		}
-
-		/* Contribution (0,0,1,1) */
-		dx10 = dx0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dy10 = dy0 - 0 - 2 * SQUISH_CONSTANT_4D;
-		dz10 = dz0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		dw10 = dw0 - 1 - 2 * SQUISH_CONSTANT_4D;
-		attn10 = 2 - dx10 * dx10 - dy10 * dy10 - dz10 * dz10 - dw10 * dw10;
-		if (attn10 > 0) {
-			attn10 *= attn10;
-			value += attn10 * attn10 * extrapolate4(ctx, xsb + 0, ysb + 0, zsb + 1, wsb + 1, dx10, dy10, dz10, dw10);
-		}
 	}
 
-	/* First extra vertex */
-	attn_ext0 = 2 - dx_ext0 * dx_ext0 - dy_ext0 * dy_ext0 - dz_ext0 * dz_ext0 - dw_ext0 * dw_ext0;
-	if (attn_ext0 > 0)
-	{
-		attn_ext0 *= attn_ext0;
-		value += attn_ext0 * attn_ext0 * extrapolate4(ctx, xsv_ext0, ysv_ext0, zsv_ext0, wsv_ext0, dx_ext0, dy_ext0, dz_ext0, dw_ext0);
-	}
+	*lo = vlo / NORM_CONSTANT_3D;
+	*hi = vhi / NORM_CONSTANT_3D;
+}
 
-	/* Second extra vertex */
-	attn_ext1 = 2 - dx_ext1 * dx_ext1 - dy_ext1 * dy_ext1 - dz_ext1 * dz_ext1 - dw_ext1 * dw_ext1;
-	if (attn_ext1 > 0)
-	{
-		attn_ext1 *= attn_ext1;
-		value += attn_ext1 * attn_ext1 * extrapolate4(ctx, xsv_ext1, ysv_ext1, zsv_ext1, wsv_ext1, dx_ext1, dy_ext1, dz_ext1, dw_ext1);
-	}
+double open_simplex_noise3_fractal(const struct osn_context *ctx, const struct osn_fractal *f,
+	double x, double y, double z, struct osn_fractal_stats *stats)
+{
+	return fractal3(ctx, f, x, y, z, stats);
+}
 
-	/* Third extra vertex */
-	attn_ext2 = 2 - dx_ext2 * dx_ext2 - dy_ext2 * dy_ext2 - dz_ext2 * dz_ext2 - dw_ext2 * dw_ext2;
-	if (attn_ext2 > 0)
-	{
-		attn_ext2 *= attn_ext2;
-		value += attn_ext2 * attn_ext2 * extrapolate4(ctx, xsv_ext2, ysv_ext2, zsv_ext2, wsv_ext2, dx_ext2, dy_ext2, dz_ext2, dw_ext2);
-	}
+float open_simplex_noise3f_fractal(const struct osn_context *ctx, const struct osn_fractal *f,
+	float x, float y, float z, struct osn_fractal_stats *stats)
+{
+	return fractal3f(ctx, f, x, y, z, stats);
+}
+
+int open_simplex_noise3_fractal_grid(const struct osn_context *ctx, const struct osn_fractal *f,
+	double x0, double y0, double z0, double step, int nx, int ny, int nz, double *out,
+	struct osn_fractal_stats *stats)
+{
+	return fractal3_grid(ctx, grid_row3_select(), f, x0, y0, z0, step, nx, ny, nz, out, stats);
+}
 
-	return value / NORM_CONSTANT_4D;
+int open_simplex_noise3f_fractal_grid(const struct osn_context *ctx, const struct osn_fractal *f,
+	float x0, float y0, float z0, float step, int nx, int ny, int nz, float *out,
+	struct osn_fractal_stats *stats)
+{
+	return fractal3_gridf(ctx, grid_row3f_select(), f, x0, y0, z0, step, nx, ny, nz, out, stats);
 }
@@ -0,0 +1,250 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "svo.h"
+
+static inline uint8_t svo_child_index(uint8_t depth, uint32_t x, uint32_t y, uint32_t z) {
+	uint8_t shift = depth - 1;
+	return (x >> shift & 1) << 2 | (y >> shift & 1) << 1 | (z >> shift & 1);
+}
+
+void svo_new(svo_t *self, uint8_t depth) {
+	self->capacity = 64;
+	self->nodes = malloc(sizeof(*self->nodes) * self->capacity);
+	if (!self->nodes) {
+		fprintf(stderr, "error: out of memory allocating octree\n");
+		exit(1);
+	}
+
+	memset(self->nodes, 0, sizeof(*self->nodes));
+	self->count = 1;
+	self->free_block = 0;
+	self->depth = depth;
+}
+
+void svo_free(svo_t *self) {
+	free(self->nodes);
+	self->nodes = NULL;
+	self->count = 0;
+	self->capacity = 0;
+	self->free_block = 0;
+}
+
+/* returns the index of 8 fresh zeroed nodes. may move the node array */
+static uint32_t svo_block_alloc(svo_t *self) {
+	uint32_t block;
+
+	if (self->free_block) {
+		block = self->free_block;
+		self->free_block = self->nodes[block].first_child;
+	} else {
+		if (self->count + 8 > self->capacity) {
+			svo_node_t *nodes = realloc(self->nodes, sizeof(*nodes) * self->capacity * 2);
+			if (!nodes) {
+				fprintf(stderr, "error: out of memory growing octree\n");
+				exit(1);
+			}
+			self->nodes = nodes;
+			self->capacity *= 2;
+		}
+
+		block = self->count;
+		self->count += 8;
+	}
+
+	memset(self->nodes + block, 0, sizeof(*self->nodes) * 8);
+	return block;
+}
+
+static void svo_block_release(svo_t *self, uint32_t block) {
+	self->nodes[block].first_child = self->free_block;
+	self->free_block = block;
+}
+
+/* returns true once the node is entirely solid, so its parent can turn it
+ * into a leaf. indices rather than pointers are held across the recursion
+ * as allocating a block may move the array
+ */
+static bool svo_set_node(svo_t *self, uint32_t index, uint8_t depth, uint32_t x, uint32_t y, uint32_t z) {
+	uint8_t c = svo_child_index(depth, x, y, z);
+	uint8_t bit = 1 << c;
+
+	if (self->nodes[index].leaf_mask & bit) {
+		/* already full of blocks; no need to set */
+		return false;
+	}
+
+	if (depth == 1) {
+		self->nodes[index].child_mask |= bit;
+		self->nodes[index].leaf_mask |= bit;
+		return self->nodes[index].leaf_mask == 0xff;
+	}
+
+	/* selected child not generated so must generate it */
+	if (!(self->nodes[index].child_mask & bit)) {
+		if (!self->nodes[index].first_child) {
+			uint32_t block = svo_block_alloc(self);
+			self->nodes[index].first_child = block;
+		}
+		self->nodes[index].child_mask |= bit;
+	}
+
+	if (!svo_set_node(self, self->nodes[index].first_child + c, depth - 1, x, y, z))
+		return false;
+
+	/* the child filled up; its slot in the block is no longer needed */
+	svo_node_t *node = self->nodes + index;
+	node->leaf_mask |= bit;
+	if (!(node->child_mask & ~node->leaf_mask)) {
+		svo_block_release(self, node->first_child);
+		node->first_child = 0;
+	}
+
+	return node->leaf_mask == 0xff;
+}
+
+void svo_set(svo_t *self, uint32_t x, uint32_t y, uint32_t z) {
+	uint32_t size = 1u << self->depth;
+
+	if (x >= size || y >= size || z >= size)
+		return;
+
+	svo_set_node(self, 0, self->depth, x, y, z);
+}
+
+bool svo_find(svo_t const *self, uint8_t min_depth, uint32_t x, uint32_t y, uint32_t z) {
+	uint32_t size = 1u << self->depth;
+	uint32_t index = 0;
+
+	if (x >= size || y >= size || z >= size)
+		return false;
+
+	for (uint8_t depth = self->depth; depth > 0; depth--) {
+		svo_node_t const *node = self->nodes + index;
+		uint8_t c = svo_child_index(depth, x, y, z);
+
+		if (node->leaf_mask >> c & 1)
+			return depth - 1 >= min_depth;
+
+		/* empty, or only split into leaves smaller than asked for */
+		if (!(node->child_mask >> c & 1) || depth - 1 <= min_depth)
+			return false;
+
+		index = node->first_child + c;
+	}
+
+	return false;
+}
+
+/* returns true if every voxel of the box [lo, hi) inside the node at index,
+ * whose corner is at x, y, z, is solid
+ */
+static bool svo_solid_box(svo_t const *self, uint32_t index, uint8_t depth, uint32_t x, uint32_t y, uint32_t z,
+	uint32_t const lo[3], uint32_t const hi[3]) {
+	uint32_t half = 1u << (depth - 1);
+	svo_node_t const *node = self->nodes + index;
+
+	for (uint8_t c = 0; c < 8; c++) {
+		uint32_t corner[3] = { x + (c >> 2 & 1) * half, y + (c >> 1 & 1) * half, z + (c & 1) * half };
+		bool overlaps = true;
+		for (uint8_t axis = 0; axis < 3; axis++)
+			overlaps = overlaps && corner[axis] < hi[axis] && lo[axis] < corner[axis] + half;
+
+		if (!overlaps || node->leaf_mask >> c & 1)
+			continue;
+
+		if (!(node->child_mask >> c & 1) ||
+			!svo_solid_box(self, node->first_child + c, depth - 1, corner[0], corner[1], corner[2], lo, hi))
+			return false;
+	}
+
+	return true;
+}
+
+/* a leaf is hidden when the layer of voxels beyond each of its faces is
+ * solid, whatever size the leaves making it up are. faces on the edge of
+ * the tree count as open, as voxel_set_visible has them
+ */
+static bool svo_leaf_hidden(svo_t const *self, uint32_t const corner[3], uint32_t size) {
+	uint32_t edge = 1u << self->depth;
+
+	for (uint8_t face = 0; face < 6; face++) {
+		uint8_t axis = face >> 1;
+		uint32_t lo[3] = { corner[0], corner[1], corner[2] };
+		uint32_t hi[3] = { corner[0] + size, corner[1] + size, corner[2] + size };
+
+		if (face & 1) {
+			if (hi[axis] == edge)
+				return false;
+			lo[axis] = hi[axis];
+			hi[axis]++;
+		} else {
+			if (!lo[axis])
+				return false;
+			hi[axis] = lo[axis];
+			lo[axis]--;
+		}
+
+		if (!svo_solid_box(self, 0, self->depth, 0, 0, 0, lo, hi))
+			return false;
+	}
+
+	return true;
+}
+
+static void svo_set_visible_node(svo_t *self, uint32_t index, uint8_t depth, uint32_t x, uint32_t y, uint32_t z) {
+	uint32_t half = 1u << (depth - 1);
+
+	for (uint8_t c = 0; c < 8; c++) {
+		uint32_t corner[3] = { x + (c >> 2 & 1) * half, y + (c >> 1 & 1) * half, z + (c & 1) * half };
+		svo_node_t *node = self->nodes + index;
+
+		if (!(node->child_mask >> c & 1))
+			continue;
+
+		if (!(node->leaf_mask >> c & 1)) {
+			svo_set_visible_node(self, node->first_child + c, depth - 1, corner[0], corner[1], corner[2]);
+			continue;
+		}
+
+		if (svo_leaf_hidden(self, corner, half))
+			node->hidden_mask |= 1 << c;
+		else
+			node->hidden_mask &= ~(1 << c);
+	}
+}
+
+void svo_set_visible(svo_t *self) {
+	svo_set_visible_node(self, 0, self->depth, 0, 0, 0);
+}
+
+bool svo_hidden(svo_t const *self, uint32_t x, uint32_t y, uint32_t z) {
+	uint32_t size = 1u << self->depth;
+	uint32_t index = 0;
+
+	if (x >= size || y >= size || z >= size)
+		return false;
+
+	for (uint8_t depth = self->depth; depth > 0; depth--) {
+		svo_node_t const *node = self->nodes + index;
+		uint8_t c = svo_child_index(depth, x, y, z);
+
+		if (node->leaf_mask >> c & 1)
+			return node->hidden_mask >> c & 1;
+		if (!(node->child_mask >> c & 1))
+			return false;
+
+		index = node->first_child + c;
+	}
+
+	return false;
+}
+
+size_t svo_bytes(svo_t const *self) {
+	return sizeof(*self->nodes) * self->capacity;
+}
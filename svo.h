@@ -0,0 +1,61 @@
+#ifndef SVO_H__
+#define SVO_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* compact sparse voxel octree. where voct_node_t spends a pointer on every
+ * child, an svo node is 8 bytes: which children exist, which of those are
+ * solid leaves, and where its children start in one contiguous node array.
+ *
+ * leaves have no node of their own; a set bit in leaf_mask means the whole
+ * child is solid. children that are further split live in a block of 8
+ * adjacent nodes starting at first_child, child i at first_child + i, so
+ * siblings always share a cache line
+ */
+typedef struct svo_node_t {
+	uint8_t child_mask;
+	uint8_t leaf_mask;
+
+	/* leaves buried under solid neighbours on all six sides */
+	uint8_t hidden_mask;
+	uint8_t pad;
+
+	/* 0 when no child is split; node 0 is the root so is never a child */
+	uint32_t first_child;
+} svo_node_t;
+
+typedef struct svo_t {
+	svo_node_t *nodes;
+	uint32_t count;
+	uint32_t capacity;
+
+	/* freed child blocks, chained through first_child of their first node */
+	uint32_t free_block;
+
+	/* the root covers 2^depth voxels a side */
+	uint8_t depth;
+} svo_t;
+
+void svo_new(svo_t *self, uint8_t depth);
+void svo_free(svo_t *self);
+
+/* marks a unit voxel solid, merging children into a leaf once all 8 are */
+void svo_set(svo_t *self, uint32_t x, uint32_t y, uint32_t z);
+
+/* returns true if a solid leaf at least 2^min_depth a side covers the voxel */
+bool svo_find(svo_t const *self, uint8_t min_depth, uint32_t x, uint32_t y, uint32_t z);
+
+/* flags every leaf with no open face: the voxels beyond each of its faces
+ * are all solid, as voxel_set_visible decides it
+ */
+void svo_set_visible(svo_t *self);
+
+/* returns true if the voxel lies in a leaf svo_set_visible flagged hidden */
+bool svo_hidden(svo_t const *self, uint32_t x, uint32_t y, uint32_t z);
+
+/* bytes held by the node array */
+size_t svo_bytes(svo_t const *self);
+
+#endif
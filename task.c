@@ -0,0 +1,312 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "task.h"
+
+typedef struct task_worker_t {
+	task_pool_t *pool;
+	uint32_t index;
+} task_worker_t;
+
+/* which worker of which pool the calling thread is, if any */
+static _Thread_local task_worker_t task_self;
+
+static void task_deque_new(task_deque_t *self) {
+	memset(self, 0, sizeof(*self));
+	pthread_mutex_init(&self->lock, NULL);
+}
+
+static void task_deque_free(task_deque_t *self) {
+	pthread_mutex_destroy(&self->lock);
+	free(self->tasks);
+}
+
+static void task_deque_push(task_deque_t *self, task_t const *task) {
+	pthread_mutex_lock(&self->lock);
+
+	if (self->count == self->capacity) {
+		size_t capacity = self->capacity ? self->capacity * 2 : 64;
+		task_t *tasks = malloc(sizeof(*tasks) * capacity);
+		if (!tasks) {
+			fprintf(stderr, "error: out of memory queueing task\n");
+			exit(1);
+		}
+
+		/* unwrap the ring so it starts at 0 again */
+		for (size_t i = 0; i < self->count; i++)
+			tasks[i] = self->tasks[(self->head + i) % self->capacity];
+
+		free(self->tasks);
+		self->tasks = tasks;
+		self->head = 0;
+		self->capacity = capacity;
+	}
+
+	self->tasks[(self->head + self->count) % self->capacity] = *task;
+	self->count++;
+
+	pthread_mutex_unlock(&self->lock);
+}
+
+/* takes the newest task when back is set, else the oldest */
+static bool task_deque_take(task_deque_t *self, bool back, task_t *task) {
+	bool ret = false;
+
+	pthread_mutex_lock(&self->lock);
+
+	if (self->count) {
+		if (back) {
+			*task = self->tasks[(self->head + self->count - 1) % self->capacity];
+		} else {
+			*task = self->tasks[self->head];
+			self->head = (self->head + 1) % self->capacity;
+		}
+		self->count--;
+		ret = true;
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+/* pops from deque index, then steals from the rest in turn */
+static bool task_take(task_pool_t *self, uint32_t index, task_t *task) {
+	uint32_t count = self->worker_count + 1;
+
+	if (!atomic_load(&self->queued))
+		return false;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t victim = (index + i) % count;
+		if (task_deque_take(self->deques + victim, i == 0, task)) {
+			atomic_fetch_sub(&self->queued, 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void task_run(task_pool_t *self, task_t const *task) {
+	task->fn(task->arg);
+
+	/* the group may be gone as soon as pending reads 0, so only the pool is
+	 * touched after it
+	 */
+	if (atomic_fetch_sub(&task->group->pending, 1) == 1) {
+		pthread_mutex_lock(&self->lock);
+		pthread_cond_broadcast(&self->done);
+		pthread_mutex_unlock(&self->lock);
+	}
+}
+
+static void *task_worker_run(void *arg) {
+	task_pool_t *self = arg;
+	uint32_t index;
+
+	pthread_mutex_lock(&self->lock);
+	for (index = 0; !pthread_equal(self->threads[index], pthread_self()); index++);
+	pthread_mutex_unlock(&self->lock);
+
+	task_self = (task_worker_t){ .pool = self, .index = index };
+
+	for (;;) {
+		task_t task;
+		if (task_take(self, index, &task)) {
+			task_run(self, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&self->lock);
+		while (!atomic_load(&self->queued) && !self->stop)
+			pthread_cond_wait(&self->wake, &self->lock);
+		bool stop = self->stop && !atomic_load(&self->queued);
+		pthread_mutex_unlock(&self->lock);
+
+		if (stop)
+			break;
+	}
+
+	return NULL;
+}
+
+void task_pool_new(task_pool_t *self, uint32_t workers) {
+	memset(self, 0, sizeof(*self));
+
+	if (!workers) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = cores > 0 ? cores : 1;
+	}
+
+	self->worker_count = workers;
+	self->threads = calloc(workers, sizeof(*self->threads));
+	self->deques = calloc(workers + 1, sizeof(*self->deques));
+	if (!self->threads || !self->deques) {
+		fprintf(stderr, "error: out of memory starting task pool\n");
+		exit(1);
+	}
+
+	for (uint32_t i = 0; i <= workers; i++)
+		task_deque_new(self->deques + i);
+
+	atomic_init(&self->queued, 0);
+	pthread_mutex_init(&self->lock, NULL);
+	pthread_cond_init(&self->wake, NULL);
+	pthread_cond_init(&self->done, NULL);
+
+	/* workers find their index by their thread id, so hold them off until
+	 * every id is written
+	 */
+	pthread_mutex_lock(&self->lock);
+	for (uint32_t i = 0; i < workers; i++) {
+		if (pthread_create(self->threads + i, NULL, task_worker_run, self)) {
+			fprintf(stderr, "error: failed to start task worker\n");
+			exit(1);
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+}
+
+void task_pool_free(task_pool_t *self) {
+	pthread_mutex_lock(&self->lock);
+	self->stop = true;
+	pthread_cond_broadcast(&self->wake);
+	pthread_mutex_unlock(&self->lock);
+
+	for (uint32_t i = 0; i < self->worker_count; i++)
+		pthread_join(self->threads[i], NULL);
+
+	for (uint32_t i = 0; i <= self->worker_count; i++)
+		task_deque_free(self->deques + i);
+
+	pthread_mutex_destroy(&self->lock);
+	pthread_cond_destroy(&self->wake);
+	pthread_cond_destroy(&self->done);
+	free(self->deques);
+	free(self->threads);
+	memset(self, 0, sizeof(*self));
+}
+
+void task_spawn(task_pool_t *self, task_group_t *group, task_fn_t fn, void *arg) {
+	uint32_t index = task_self.pool == self ? task_self.index : self->worker_count;
+	task_t task = { .fn = fn, .arg = arg, .group = group };
+
+	atomic_fetch_add(&group->pending, 1);
+	task_deque_push(self->deques + index, &task);
+	atomic_fetch_add(&self->queued, 1);
+
+	pthread_mutex_lock(&self->lock);
+	pthread_cond_signal(&self->wake);
+	pthread_mutex_unlock(&self->lock);
+}
+
+void task_wait(task_pool_t *self, task_group_t *group) {
+	bool worker = task_self.pool == self;
+	uint32_t index = worker ? task_self.index : self->worker_count;
+
+	while (atomic_load(&group->pending)) {
+		task_t task;
+
+		/* a worker only helps from its own deque, which holds the tasks it
+		 * spawned and so the ones it waits on. stealing could pick up an
+		 * unrelated task and hold the group's caller up long after the
+		 * group is done
+		 */
+		if (worker ? task_deque_take(self->deques + index, true, &task) : task_take(self, index, &task)) {
+			if (worker)
+				atomic_fetch_sub(&self->queued, 1);
+			task_run(self, &task);
+			continue;
+		}
+
+		/* the rest of the group is running elsewhere. only the owner pushes
+		 * onto a deque, so a worker has nothing more to do until the last
+		 * task of the group finishes and broadcasts
+		 */
+		pthread_mutex_lock(&self->lock);
+		while (atomic_load(&group->pending) && (worker || !atomic_load(&self->queued)))
+			pthread_cond_wait(&self->done, &self->lock);
+		pthread_mutex_unlock(&self->lock);
+	}
+}
+
+void task_queue_new(task_queue_t *self, size_t capacity) {
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	self->slots = malloc(sizeof(*self->slots) * size);
+	if (!self->slots) {
+		fprintf(stderr, "error: out of memory allocating task queue\n");
+		exit(1);
+	}
+
+	/* slot i is free for the producer at position i */
+	for (size_t i = 0; i < size; i++)
+		atomic_init(&self->slots[i].seq, i);
+
+	self->mask = size - 1;
+	atomic_init(&self->tail, 0);
+	self->head = 0;
+}
+
+void task_queue_free(task_queue_t *self) {
+	free(self->slots);
+	memset(self, 0, sizeof(*self));
+}
+
+bool task_queue_push(task_queue_t *self, void *item) {
+	size_t pos = atomic_load_explicit(&self->tail, memory_order_relaxed);
+	task_queue_slot_t *slot;
+
+	for (;;) {
+		slot = self->slots + (pos & self->mask);
+		size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		ptrdiff_t diff = (ptrdiff_t) (seq - pos);
+
+		/* the slot is ours once we move tail past it. a failed exchange
+		 * reloads pos and goes round again
+		 */
+		if (!diff) {
+			if (atomic_compare_exchange_weak_explicit(&self->tail, &pos, pos + 1,
+				memory_order_relaxed, memory_order_relaxed))
+				break;
+			continue;
+		}
+
+		/* the consumer has not taken the item a lap ago yet */
+		if (diff < 0)
+			return false;
+
+		/* another producer took the slot; catch up with tail */
+		pos = atomic_load_explicit(&self->tail, memory_order_relaxed);
+	}
+
+	slot->item = item;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+	return true;
+}
+
+bool task_queue_pop(task_queue_t *self, void **item) {
+	task_queue_slot_t *slot = self->slots + (self->head & self->mask);
+
+	/* empty, or the producer holding this slot is still writing it */
+	if (atomic_load_explicit(&slot->seq, memory_order_acquire) != self->head + 1)
+		return false;
+
+	*item = slot->item;
+	/* hand the slot to the producer one lap ahead */
+	atomic_store_explicit(&slot->seq, self->head + self->mask + 1, memory_order_release);
+	self->head++;
+	return true;
+}
@@ -0,0 +1,104 @@
+#ifndef TASK_H__
+#define TASK_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+/* fixed size work stealing pool. every worker owns a deque: it pushes and
+ * pops its own tasks at the back, newest first, while idle workers steal
+ * from the front of the others, oldest first, so a thief takes the biggest
+ * piece of outstanding work. threads outside the pool queue onto a deque of
+ * their own that every worker steals from
+ */
+
+typedef void (*task_fn_t)(void *arg);
+
+/* counts tasks spawned into it that have not finished */
+typedef struct task_group_t {
+	atomic_size_t pending;
+} task_group_t;
+
+typedef struct task_t {
+	task_fn_t fn;
+	void *arg;
+	task_group_t *group;
+} task_t;
+
+/* a ring buffer growing on push; head is the front */
+typedef struct task_deque_t {
+	pthread_mutex_t lock;
+	task_t *tasks;
+	size_t head;
+	size_t count;
+	size_t capacity;
+} task_deque_t;
+
+typedef struct task_pool_t {
+	pthread_t *threads;
+	uint32_t worker_count;
+
+	/* one per worker and a last one for outside threads */
+	task_deque_t *deques;
+
+	/* tasks sitting in any deque */
+	atomic_size_t queued;
+	bool stop;
+
+	pthread_mutex_t lock;
+	/* idle workers sleep here until something is queued */
+	pthread_cond_t wake;
+	/* outside threads sleep here until a group finishes */
+	pthread_cond_t done;
+} task_pool_t;
+
+/* starts that many worker threads, or one per core when workers is 0 */
+void task_pool_new(task_pool_t *self, uint32_t workers);
+
+/* runs whatever is still queued and joins the workers */
+void task_pool_free(task_pool_t *self);
+
+/* queues fn(arg) as part of group. from a worker the task goes on its own
+ * deque, so tasks split inside a task stay local unless stolen
+ */
+void task_spawn(task_pool_t *self, task_group_t *group, task_fn_t fn, void *arg);
+
+/* returns once every task of group has run, so workers may wait on groups
+ * from inside a task. an outside thread runs any queued task while it
+ * waits; a worker only runs those on its own deque and otherwise sleeps,
+ * so it should wait on groups it spawned itself
+ */
+void task_wait(task_pool_t *self, task_group_t *group);
+
+/* bounded lock-free queue of pointers for handing results from any number
+ * of threads to a single consumer, such as the thread that owns a GL
+ * context. every slot carries a sequence number saying whose turn it is,
+ * so producers only race on tail and the consumer takes nothing at all
+ */
+typedef struct task_queue_slot_t {
+	atomic_size_t seq;
+	void *item;
+} task_queue_slot_t;
+
+typedef struct task_queue_t {
+	task_queue_slot_t *slots;
+	size_t mask;
+	atomic_size_t tail;
+	/* only the consumer touches head */
+	size_t head;
+} task_queue_t;
+
+/* holds at least capacity items */
+void task_queue_new(task_queue_t *self, size_t capacity);
+void task_queue_free(task_queue_t *self);
+
+/* safe from any thread. returns false if the queue is full */
+bool task_queue_push(task_queue_t *self, void *item);
+
+/* consumer only. returns false if nothing is ready */
+bool task_queue_pop(task_queue_t *self, void **item);
+
+#endif
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -7,49 +8,211 @@
 
 #include "voct.h"
 
-void voxel_cache_new(voxel_cache_t *self) {
-	self->ptr = calloc(VOXEL_CACHE_SIZE, sizeof(*self->ptr));
-	self->ring_index = 0;
+void voct_pool_new(voct_pool_t *self) {
+	memset(self, 0, sizeof(*self));
 }
 
-void voxel_del(voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z, uint32_t scale) {
-	/* do nothing if we hit a leaf */
-	if (tree->is_leaf) {
-		fprintf(stderr,
-			"warning: hit a leaf when trying to delete a tree node. "
-			"voxel likely already gone from tree\n");
-		return;
+void voct_pool_free(voct_pool_t *self) {
+	while (self->slabs) {
+		voct_slab_t *next = self->slabs->next;
+		free(self->slabs);
+		self->slabs = next;
 	}
+	self->slab_used = 0;
+	self->free_list = NULL;
+	self->live = 0;
+}
 
-	/* select a child */
-	voct_node_t **child = &tree->children[x>>(tree->depth - 1) & 1][y>>(tree->depth - 1) & 1][z>>(tree->depth - 1) & 1];
-	//voct_node_t **child = &tree->children[x>>(tree->depth) & 1][y>>(tree->depth) & 1][z>>(tree->depth) & 1];
+voct_node_t *voct_pool_alloc(voct_pool_t *self) {
+	voct_node_t *ret;
 
-	if (*child && (*child)->is_leaf && (*child)->voxel->scale == scale) {
-		/* mark scale as 0 in the ring buffer so we know it's free */
-		(*child)->voxel->scale = 0;
-		*child = NULL;
-	} else if (*child) {
-		voxel_del(*child, x, y, z, scale);
+	if (self->free_list) {
+		ret = self->free_list;
+		self->free_list = ret->children[0][0][0];
+	} else {
+		if (!self->slabs || self->slab_used == VOCT_POOL_SLAB) {
+			voct_slab_t *slab = malloc(sizeof(*slab));
+			if (!slab) {
+				fprintf(stderr, "error: out of memory allocating octree nodes\n");
+				exit(1);
+			}
+			slab->next = self->slabs;
+			self->slabs = slab;
+			self->slab_used = 0;
+			self->slab_count++;
+		}
+		ret = self->slabs->nodes + self->slab_used++;
 	}
+
+	self->allocs++;
+	self->live++;
+	if (self->live > self->peak)
+		self->peak = self->live;
+	return ret;
+}
+
+void voct_pool_release(voct_pool_t *self, voct_node_t *node) {
+	node->children[0][0][0] = self->free_list;
+	self->free_list = node;
+	self->frees++;
+	self->live--;
 }
 
-voxel_t *voxel_cache_push(voxel_cache_t *cache, voct_node_t *root) {
-	voxel_t *ret = cache->ptr+cache->ring_index;
+void voct_pool_print(voct_pool_t const *self) {
+	fprintf(stderr, "pool_allocs: %lu\n", self->allocs);
+	fprintf(stderr, "pool_frees: %lu\n", self->frees);
+	fprintf(stderr, "pool_live: %lu\n", self->live);
+	fprintf(stderr, "pool_peak: %lu\n", self->peak);
+	fprintf(stderr, "pool_slabs: %lu\n", self->slab_count);
+}
+
+void voxel_cache_new(voxel_cache_t *self) {
+	memset(self, 0, sizeof(*self));
+	voct_pool_new(&self->pool);
+}
 
-	for (size_t attempts = 0; ret->scale && attempts < 128; attempts++) {
-		cache->ring_index = (cache->ring_index + 1) % VOXEL_CACHE_SIZE;
-		ret = cache->ptr+cache->ring_index;
+void voxel_cache_free(voxel_cache_t *self) {
+	for (size_t i = 0; i < self->page_count; i++)
+		free(self->pages[i]);
+	free(self->pages);
+	free(self->free_slots);
+	voct_pool_free(&self->pool);
+	memset(self, 0, sizeof(*self));
+}
+
+size_t voxel_cache_bytes(voxel_cache_t const *self) {
+	return self->page_count * VOXEL_PAGE_SIZE * sizeof(voxel_t) +
+		self->page_capacity * sizeof(*self->pages) +
+		self->free_capacity * sizeof(*self->free_slots) +
+		self->pool.slab_count * sizeof(voct_slab_t);
+}
+
+void voxel_cache_print(voxel_cache_t const *self) {
+	fprintf(stderr, "cache_live: %lu\n", self->live);
+	fprintf(stderr, "cache_peak: %lu\n", self->peak);
+	fprintf(stderr, "cache_slots: %lu\n", self->slot_count);
+	fprintf(stderr, "cache_pages: %lu\n", self->page_count);
+	fprintf(stderr, "cache_bytes: %lu\n", voxel_cache_bytes(self));
+	voct_pool_print(&self->pool);
+}
+
+/* doubles a growable array of pointers, exiting when out of memory */
+static void *voxel_cache_grow(void *ptr, size_t *capacity, size_t elem) {
+	size_t next = *capacity ? *capacity * 2 : 64;
+	void *ret = realloc(ptr, next * elem);
+	if (!ret) {
+		fprintf(stderr, "error: out of memory growing voxel cache\n");
+		exit(1);
 	}
+	*capacity = next;
+	return ret;
+}
 
-	/* if scale is not 0, then voxel must already exist */
-	if (ret->scale) {
-		voxel_del(root, ret->x, ret->y, ret->z, ret->scale);
+/* moves every node of other into self. the unused end of other's newest
+ * slab goes on the freelist, as only self's newest slab is allocated from
+ */
+static void voct_pool_adopt(voct_pool_t *self, voct_pool_t *other) {
+	if (other->slabs) {
+		voct_slab_t *tail = other->slabs;
+		while (tail->next)
+			tail = tail->next;
+
+		if (self->slabs) {
+			for (size_t i = other->slab_used; i < VOCT_POOL_SLAB; i++) {
+				other->slabs->nodes[i].children[0][0][0] = other->free_list;
+				other->free_list = other->slabs->nodes + i;
+			}
+			tail->next = self->slabs->next;
+			self->slabs->next = other->slabs;
+		} else {
+			self->slabs = other->slabs;
+			self->slab_used = other->slab_used;
+		}
+	}
+
+	while (other->free_list) {
+		voct_node_t *node = other->free_list;
+		other->free_list = node->children[0][0][0];
+		node->children[0][0][0] = self->free_list;
+		self->free_list = node;
 	}
-	cache->ring_index = (cache->ring_index + 1) % VOXEL_CACHE_SIZE;
+
+	self->allocs += other->allocs;
+	self->frees += other->frees;
+	self->live += other->live;
+	self->peak = self->live > self->peak ? self->live : self->peak;
+	self->slab_count += other->slab_count;
+	memset(other, 0, sizeof(*other));
+}
+
+/* hands out a released slot if any, else the next unused one */
+static voxel_t *voxel_cache_push(voxel_cache_t *cache) {
+	voxel_t *ret;
+
+	if (cache->free_count) {
+		ret = cache->free_slots[--cache->free_count];
+	} else {
+		if (cache->slot_count == cache->page_count * VOXEL_PAGE_SIZE) {
+			if (cache->page_count == cache->page_capacity)
+				cache->pages = voxel_cache_grow(cache->pages, &cache->page_capacity, sizeof(*cache->pages));
+
+			voxel_t *page = malloc(sizeof(*page) * VOXEL_PAGE_SIZE);
+			if (!page) {
+				fprintf(stderr, "error: out of memory growing voxel cache\n");
+				exit(1);
+			}
+			cache->pages[cache->page_count++] = page;
+		}
+		ret = voxel_cache_slot(cache, cache->slot_count++);
+	}
+
+	cache->live++;
+	if (cache->live > cache->peak)
+		cache->peak = cache->live;
 	return ret;
 }
 
+static void voxel_cache_release(voxel_cache_t *cache, voxel_t *voxel) {
+	if (cache->free_count == cache->free_capacity)
+		cache->free_slots = voxel_cache_grow(cache->free_slots, &cache->free_capacity, sizeof(*cache->free_slots));
+
+	/* scale 0 keeps free slots out of anything scanning for BLOCK_FLAG_EXISTS */
+	voxel->scale = 0;
+	cache->free_slots[cache->free_count++] = voxel;
+	cache->live--;
+}
+
+void voxel_cache_adopt(voxel_cache_t *self, voxel_cache_t *other) {
+	/* slots are indexed straight across the pages, so the unused end of
+	 * self's last page is released before other's pages go after it
+	 */
+	while (self->slot_count < self->page_count * VOXEL_PAGE_SIZE) {
+		voxel_cache_release(self, voxel_cache_slot(self, self->slot_count++));
+		self->live++;
+	}
+
+	for (size_t i = 0; i < other->page_count; i++) {
+		if (self->page_count == self->page_capacity)
+			self->pages = voxel_cache_grow(self->pages, &self->page_capacity, sizeof(*self->pages));
+		self->pages[self->page_count++] = other->pages[i];
+	}
+	self->slot_count += other->slot_count;
+
+	for (size_t i = 0; i < other->free_count; i++) {
+		if (self->free_count == self->free_capacity)
+			self->free_slots = voxel_cache_grow(self->free_slots, &self->free_capacity, sizeof(*self->free_slots));
+		self->free_slots[self->free_count++] = other->free_slots[i];
+	}
+
+	self->live += other->live;
+	self->peak = self->live > self->peak ? self->live : self->peak;
+	voct_pool_adopt(&self->pool, &other->pool);
+
+	free(other->pages);
+	free(other->free_slots);
+	voxel_cache_new(other);
+}
+
 static inline uint32_t uniform_scale(uint8_t depth, block_flags_t flags) {
 	return depth << 24 | depth << 16 | depth << 8 | flags;
 }
@@ -65,24 +228,65 @@ static inline uint8_t get_scale_z(uint32_t val) {
 	return (val >>  8) & 0xff;
 }
 
-voct_node_t *voxel_new(voxel_cache_t *cache, voct_node_t *root, uint32_t x, uint32_t y, uint32_t z, uint8_t depth) {
-	voct_node_t *ret = calloc(1, sizeof(*ret));
+voct_node_t *voxel_new(voxel_cache_t *cache, uint32_t x, uint32_t y, uint32_t z, uint8_t depth) {
+	voct_node_t *ret = voct_pool_alloc(&cache->pool);
 	ret->is_leaf = true;
 	ret->depth = depth;
-	ret->voxel = voxel_cache_push(cache, root);
+	ret->voxel = voxel_cache_push(cache);
 	ret->voxel->scale = uniform_scale(depth, BLOCK_FLAG_EXISTS);
 	/* fix voxel to the grid */
-	ret->voxel->x = x & ~((1 << depth << 1) - 1);
-	ret->voxel->y = y & ~((1 << depth << 1) - 1);
-	ret->voxel->z = z & ~((1 << depth << 1) - 1);
+	ret->voxel->x = x & ~((1 << depth) - 1);
+	ret->voxel->y = y & ~((1 << depth) - 1);
+	ret->voxel->z = z & ~((1 << depth) - 1);
 	return ret;
 }
 
-void voxel_set(voxel_cache_t *cache, voct_node_t *root, voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z) {
+voct_node_t *voct_node_new(voxel_cache_t *cache, uint8_t depth) {
+	voct_node_t *ret = voct_pool_alloc(&cache->pool);
+	ret->is_leaf = false;
+	ret->depth = depth;
+	memset(ret->children, 0, sizeof(ret->children));
+	return ret;
+}
+
+/* if all children are leaf nodes, current node can become a leaf node by
+ * sacrificing children
+ */
+bool voxel_collapse(voxel_cache_t *cache, voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z) {
+	bool all_leaf = true;
+	for (uint8_t i = 0; all_leaf && i < 8; i++) {
+	 	voct_node_t *child = tree->children[(i&4) >> 2][(i&2) >> 1][i&1];
+	 	all_leaf &= child && child->is_leaf;
+	}
+
+	if (!all_leaf)
+		return false;
+
+	for (uint8_t i = 0; i < 8; i++) {
+	 	voct_node_t **child = &tree->children[(i&4) >> 2][(i&2) >> 1][i&1];
+		if (*child) {
+		 	voxel_cache_release(cache, (*child)->voxel);
+		 	voct_pool_release(&cache->pool, *child);
+		 	*child = NULL;
+		}
+	}
+
+	tree->is_leaf = true;
+	tree->voxel = voxel_cache_push(cache);
+	tree->voxel->scale = uniform_scale(tree->depth, BLOCK_FLAG_EXISTS);
+
+	/* fix voxel to the grid */
+	tree->voxel->x = x & ~((1 << tree->depth) - 1);
+	tree->voxel->y = y & ~((1 << tree->depth) - 1);
+	tree->voxel->z = z & ~((1 << tree->depth) - 1);
+	return true;
+}
+
+void voxel_set(voxel_cache_t *cache, voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z) {
 	if (!tree->depth) {
 		tree->is_leaf = true;
-		tree->voxel = voxel_cache_push(cache, root);
-		tree->voxel->scale = uniform_scale(0, 0);
+		tree->voxel = voxel_cache_push(cache);
+		tree->voxel->scale = uniform_scale(0, BLOCK_FLAG_EXISTS);
 		tree->voxel->x = x;
 		tree->voxel->y = y;
 		tree->voxel->z = z;
@@ -99,43 +303,122 @@ void voxel_set(voxel_cache_t *cache, voct_node_t *root, voct_node_t *tree, uint3
 
 	/* selected child not generated so must generate it */
 	if (!*child) {
-		*child = malloc(sizeof(**child));
-
-		(*child)->is_leaf = false;
-		(*child)->depth = tree->depth - 1;
-		memset((*child)->children, 0, sizeof((*child)->children));
+		*child = voct_node_new(cache, tree->depth - 1);
 	}
 
-	voxel_set(cache, root, *child, x, y, z);
+	voxel_set(cache, *child, x, y, z);
 
-	/* if all children are leaf nodes, current node can become a leaf node by
-	 * sacrificing children
-	 */
-	bool all_leaf = true;
-	for (uint8_t i = 0; all_leaf && i < 8; i++) {
-	 	voct_node_t *child = tree->children[(i&4) >> 2][(i&2) >> 1][i&1];
-	 	all_leaf &= child && child->is_leaf;
+	voxel_collapse(cache, tree, x, y, z);
+}
+
+/* the 4 * 4 * 4 block at x, y, z as bit (i * 4 + j) * 4 + k */
+static uint64_t voxel_build_block(uint64_t const *occ, uint32_t x, uint32_t y, uint32_t z) {
+	uint64_t bits = 0;
+	for (uint32_t i = 0; i < 4; i++)
+		for (uint32_t j = 0; j < 4; j++)
+			bits |= (occ[voxel_occ_index(x + i, y + j, z)] >> (z & 63) & 0xf) << ((i * 4 + j) * 4);
+	return bits;
+}
+
+/* bits of the 2 * 2 * 2 octant c of a block, as child index i << 2 | j << 1 | k */
+static uint8_t voxel_build_octant(uint64_t bits, uint8_t c) {
+	uint8_t ret = 0;
+	for (uint8_t i = 0; i < 8; i++) {
+		uint32_t bx = (c >> 2 & 1) * 2 + (i >> 2 & 1);
+		uint32_t by = (c >> 1 & 1) * 2 + (i >> 1 & 1);
+		uint32_t bz = (c & 1) * 2 + (i & 1);
+		ret |= (bits >> ((bx * 4 + by) * 4 + bz) & 1) << i;
 	}
+	return ret;
+}
+
+/* node for the 2 * 2 * 2 octant given its bits, whose children are unit voxels */
+static voct_node_t *voxel_build_pair(voxel_cache_t *cache, uint8_t bits,
+	uint32_t x, uint32_t y, uint32_t z) {
+	voct_node_t *node = voct_node_new(cache, 1);
+	for (uint8_t i = 0; i < 8; i++)
+		if (bits >> i & 1)
+			node->children[(i&4) >> 2][(i&2) >> 1][i&1] = voxel_new(cache,
+				x + (i >> 2 & 1), y + (i >> 1 & 1), z + (i & 1), 0);
+	return node;
+}
+
+/* builds the subtree covering [x, x + 2^depth) on each axis. a solid subtree
+ * is reported through full rather than allocated, so that the parent can
+ * merge it with its siblings; NULL without full is empty space
+ */
+static voct_node_t *voxel_build_node(voxel_cache_t *cache, uint64_t const *occ,
+	uint32_t x, uint32_t y, uint32_t z, uint8_t depth, bool *full) {
+	voct_node_t *children[8];
+	bool child_full[8];
+	bool all_full = true;
+	bool all_empty = true;
+
+	if (depth == 2) {
+		uint64_t bits = voxel_build_block(occ, x, y, z);
+		*full = bits == ~(uint64_t) 0;
+		if (*full || !bits)
+			return NULL;
 
-	if (all_leaf) {
 		for (uint8_t i = 0; i < 8; i++) {
-		 	voct_node_t **child = &tree->children[(i&4) >> 2][(i&2) >> 1][i&1];
-			if (*child) {
-			 	(*child)->voxel->scale = 0;
-			 	free(*child);
-			 	*child = NULL;
-			}
+			uint8_t octant = voxel_build_octant(bits, i);
+			child_full[i] = octant == 0xff;
+			children[i] = octant && !child_full[i] ? voxel_build_pair(cache, octant,
+				x + (i >> 2 & 1) * 2, y + (i >> 1 & 1) * 2, z + (i & 1) * 2) : NULL;
+		}
+	} else {
+		uint32_t half = 1 << (depth - 1);
+		for (uint8_t i = 0; i < 8; i++) {
+			children[i] = voxel_build_node(cache, occ,
+				x + (i >> 2 & 1) * half, y + (i >> 1 & 1) * half, z + (i & 1) * half, depth - 1, child_full + i);
+			all_full &= child_full[i];
+			all_empty &= !child_full[i] && !children[i];
 		}
 
-		tree->is_leaf = true;
-		tree->voxel = voxel_cache_push(cache, root);
-		tree->voxel->scale = uniform_scale(tree->depth, BLOCK_FLAG_EXISTS);
+		*full = all_full;
+		if (all_full || all_empty)
+			return NULL;
+	}
+
+	voct_node_t *node = voct_node_new(cache, depth);
+	uint32_t half = 1 << (depth - 1);
+	for (uint8_t i = 0; i < 8; i++) {
+		uint32_t cx = x + (i >> 2 & 1) * half, cy = y + (i >> 1 & 1) * half, cz = z + (i & 1) * half;
+		node->children[(i&4) >> 2][(i&2) >> 1][i&1] = child_full[i] ?
+			voxel_new(cache, cx, cy, cz, depth - 1) : children[i];
+	}
+	return node;
+}
 
-		/* fix voxel to the grid */
-		tree->voxel->x = x & ~((1 << tree->depth) - 1);
-		tree->voxel->y = y & ~((1 << tree->depth) - 1);
-		tree->voxel->z = z & ~((1 << tree->depth) - 1);
+void voxel_build(voxel_cache_t *cache, voct_node_t *root, uint64_t const *occ) {
+	bool full;
+
+	if (root->depth == VOXEL_OCC_DEPTH) {
+		voct_node_t *node = voxel_build_node(cache, occ, 0, 0, 0, VOXEL_OCC_DEPTH, &full);
+		if (full) {
+			/* can't hand back a new root, so solid becomes a leaf in place */
+			root->is_leaf = true;
+			root->voxel = voxel_cache_push(cache);
+			root->voxel->scale = uniform_scale(root->depth, BLOCK_FLAG_EXISTS);
+			root->voxel->x = root->voxel->y = root->voxel->z = 0;
+		} else if (node) {
+			memcpy(root->children, node->children, sizeof(root->children));
+			voct_pool_release(&cache->pool, node);
+		}
+		return;
+	}
+
+	/* deeper roots hold the chunk in their lowest child */
+	voct_node_t *tree = root;
+	while (tree->depth > VOXEL_OCC_DEPTH + 1) {
+		voct_node_t **child = &tree->children[0][0][0];
+		if (!*child)
+			*child = voct_node_new(cache, tree->depth - 1);
+		tree = *child;
 	}
+
+	voct_node_t *node = voxel_build_node(cache, occ, 0, 0, 0, VOXEL_OCC_DEPTH, &full);
+	tree->children[0][0][0] = full ? voxel_new(cache, 0, 0, 0, VOXEL_OCC_DEPTH) : node;
 }
 
 voxel_t *voxel_find(voct_node_t *tree, uint8_t max_depth, uint32_t x, uint32_t y, uint32_t z) {
@@ -155,88 +438,424 @@ voxel_t *voxel_find(voct_node_t *tree, uint8_t max_depth, uint32_t x, uint32_t y
 	}
 }
 
-void voxel_set_visible(voct_node_t *root, voct_node_t *tree) {
-	if (!tree) {
-		return;
+/* neighbours are indexed by face. each is the node of the same depth
+ * across that face, or a larger leaf covering it, or NULL
+ */
+static voct_node_t *voxel_neighbour_child(voct_node_t *node, uint8_t const c[3]) {
+	if (!node || node->is_leaf)
+		return node;
+
+	return node->children[c[0]][c[1]][c[2]];
+}
+
+/* returns true if the side of node facing down or up the axis is covered
+ * by leaves all the way across
+ */
+static bool voxel_side_solid(voct_node_t const *node, uint8_t axis, uint8_t side) {
+	if (!node || node->is_leaf)
+		return node;
+
+	for (uint8_t i = 0; i < 8; i++) {
+		uint8_t c[3] = { i >> 2 & 1, i >> 1 & 1, i & 1 };
+		if (c[axis] != side)
+			continue;
+
+		if (!voxel_side_solid(node->children[c[0]][c[1]][c[2]], axis, side))
+			return false;
 	}
 
+	return true;
+}
+
+static void voxel_set_visible_node(voct_node_t *tree, voct_node_t *const neighbours[VOXEL_FACE_COUNT]) {
 	if (tree->is_leaf) {
-		uint32_t offset = 1 << tree->depth;
+		uint32_t flags = 0;
+		for (uint8_t i = 0; i < VOXEL_FACE_COUNT; i++) {
+			/* a split neighbour closes the face only if its own facing
+			 * side has no gaps
+			 */
+			if (!voxel_side_solid(neighbours[i], i >> 1, !(i & 1)))
+				flags |= BLOCK_FLAG_FACE(i);
+		}
 
-		if (!voxel_find(root, tree->depth, tree->voxel->x + offset, tree->voxel->y, tree->voxel->z))
-			return;
+		if (!flags)
+			flags = BLOCK_FLAG_HIDDEN;
 
-		if (!voxel_find(root, tree->depth, tree->voxel->x, tree->voxel->y + offset, tree->voxel->z))
-			return;
+		/* also undoes any voxel_greedy merge */
+		tree->voxel->scale = uniform_scale(tree->depth, BLOCK_FLAG_EXISTS | flags);
+		return;
+	}
 
-		if (!voxel_find(root, tree->depth, tree->voxel->x, tree->voxel->y, tree->voxel->z + offset))
-			return;
+	for (uint8_t i = 0; i < 8; i++) {
+		uint8_t c[3] = { i >> 2 & 1, i >> 1 & 1, i & 1 };
+		voct_node_t *child = tree->children[c[0]][c[1]][c[2]];
+		if (!child)
+			continue;
+
+		voct_node_t *child_neighbours[VOXEL_FACE_COUNT];
+		for (uint8_t axis = 0; axis < 3; axis++) {
+			uint8_t across[3] = { c[0], c[1], c[2] };
+			across[axis] ^= 1;
+
+			/* the neighbour on the inner side is a sibling, the one on the
+			 * outer side is a child of this node's neighbour
+			 */
+			voct_node_t *inner = tree->children[across[0]][across[1]][across[2]];
+			voct_node_t *outer = voxel_neighbour_child(neighbours[axis * 2 + c[axis]], across);
+
+			child_neighbours[axis * 2 + c[axis]] = outer;
+			child_neighbours[axis * 2 + !c[axis]] = inner;
+		}
 
-		if (tree->voxel->x == 0 ||
-			!voxel_find(root, tree->depth, tree->voxel->x - offset, tree->voxel->y, tree->voxel->z))
-			return;
+		voxel_set_visible_node(child, child_neighbours);
+	}
+}
 
-		if (tree->voxel->y == 0 ||
-			!voxel_find(root, tree->depth, tree->voxel->x, tree->voxel->y - offset, tree->voxel->z))
-			return;
+void voxel_set_visible(voct_node_t *tree) {
+	if (!tree)
+		return;
 
-		if (tree->voxel->z == 0 ||
-			!voxel_find(root, tree->depth, tree->voxel->x, tree->voxel->y, tree->voxel->z - offset))
-			return;
+	voct_node_t *const neighbours[VOXEL_FACE_COUNT] = { NULL };
+	voxel_set_visible_node(tree, neighbours);
+}
 
-		tree->voxel->scale |= BLOCK_FLAG_HIDDEN;
+/* returns the leaf at depth with its corner at x, y, z, if there is one */
+static voct_node_t *voxel_leaf_at(voct_node_t *tree, uint8_t depth, uint32_t x, uint32_t y, uint32_t z) {
+	if ((x | y | z) >> tree->depth)
+		return NULL;
 
-	} else {
-		for (uint8_t i = 0; i < 8; i++) {
-		 	voct_node_t *child = tree->children[(i&4) >> 2][(i&2) >> 1][i&1];
-		 	voxel_set_visible(root, child);
-		}
+	while (tree && !tree->is_leaf && tree->depth > depth) {
+		uint8_t shift = tree->depth - 1;
+		tree = tree->children[x >> shift & 1][y >> shift & 1][z >> shift & 1];
 	}
+
+	if (!tree || !tree->is_leaf || tree->depth != depth)
+		return NULL;
+
+	return tree;
 }
 
-void voxel_greedy(voct_node_t *tree) {
+typedef struct voxel_greedy_t {
+	voct_node_t **leaves;
+	size_t count;
+	size_t capacity;
+} voxel_greedy_t;
+
+/* collects every leaf with an open face, in morton order */
+static void voxel_greedy_gather(voxel_greedy_t *self, voct_node_t *tree) {
 	if (!tree)
 		return;
 
-	if (tree->is_leaf)
+	if (tree->is_leaf) {
+		if (!(tree->voxel->scale & BLOCK_FLAG_FACES))
+			return;
+
+		if (self->count == self->capacity)
+			self->leaves = voxel_cache_grow(self->leaves, &self->capacity, sizeof(*self->leaves));
+		self->leaves[self->count++] = tree;
 		return;
+	}
 
+	for (uint8_t i = 0; i < 8; i++)
+		voxel_greedy_gather(self, tree->children[(i&4) >> 2][(i&2) >> 1][i&1]);
+}
 
-	for (uint8_t i = 0; i < 2; i++) {
-		for (uint8_t j = 0; j < 2; j++) {
-			voct_node_t *child_a = tree->children[i][j][0];
-			voct_node_t *child_b = tree->children[i][j][1];
+/* morton order is monotonic along each axis with the others fixed, so in
+ * gather order the first leaf of any run along an axis is reached before
+ * the rest of it
+ */
+size_t voxel_greedy(voct_node_t *tree) {
+	voxel_greedy_t self = { 0 };
+	size_t merged = 0;
 
-			if (!child_a || !child_a->is_leaf) {
-				voxel_greedy(child_a);
+	if (!tree)
+		return 0;
+
+	voxel_greedy_gather(&self, tree);
+
+	for (uint8_t axis = 0; axis < 3; axis++) {
+		uint8_t shift = 24 - 8 * axis;
+		uint32_t ends = BLOCK_FLAG_FACE(axis * 2) | BLOCK_FLAG_FACE(axis * 2 + 1);
+		uint32_t far_face = BLOCK_FLAG_FACE(axis * 2 + 1);
+
+		for (size_t i = 0; i < self.count; i++) {
+			voct_node_t *head = self.leaves[i];
+			voxel_t *voxel = head->voxel;
+
+			/* absorbed into an earlier box */
+			if (!(voxel->scale & BLOCK_FLAG_FACES))
 				continue;
+
+			/* the packed extent is at most a whole chunk */
+			uint32_t limit = 1 << (VOXEL_OCC_DEPTH - head->depth);
+			voct_node_t *run[VOXEL_OCC_SIZE];
+			run[0] = head;
+			uint32_t pos[3] = { voxel->x, voxel->y, voxel->z };
+			uint32_t length = 1;
+
+			/* followers must match in extent and in every face that the
+			 * merged box shares with them
+			 */
+			while (length < limit) {
+				/* an open far face means nothing solid lies beyond */
+				if (run[length - 1]->voxel->scale & far_face)
+					break;
+
+				pos[axis] += 1 << head->depth;
+				voct_node_t *next = voxel_leaf_at(tree, head->depth, pos[0], pos[1], pos[2]);
+				if (!next || (next->voxel->scale ^ voxel->scale) & ~ends)
+					break;
+				run[length++] = next;
 			}
 
-			if (!child_b || !child_b->is_leaf) {
-				voxel_greedy(child_a);
+			/* extents are powers of two, so take the longest that fits and
+			 * leave the rest to start their own run
+			 */
+			uint8_t grow = 0;
+			while (2u << grow <= length)
+				grow++;
+
+			if (!grow)
 				continue;
+
+			uint32_t taken = 1 << grow;
+			uint32_t far = run[taken - 1]->voxel->scale & far_face;
+			for (uint32_t j = 1; j < taken; j++)
+				run[j]->voxel->scale = (run[j]->voxel->scale & ~(BLOCK_FLAG_HIDDEN | BLOCK_FLAG_FACES)) | BLOCK_FLAG_HIDDEN;
+
+			voxel->scale = ((voxel->scale + (grow << shift)) & ~far_face) | far;
+			merged += taken - 1;
+		}
+	}
+
+	free(self.leaves);
+	return merged;
+}
+
+static void voxel_emit_node(voxel_draw_list_t *list, voct_node_t const *tree, bool in_range) {
+	if (!tree)
+		return;
+
+	bool starts_range = list->ranges && !in_range && (tree->is_leaf || tree->depth <= list->range_depth);
+	size_t first = list->count;
+
+	if (tree->is_leaf) {
+		block_flags_t flags = tree->voxel->scale & 0xff;
+		bool visible = list->faces ? flags & list->faces : !(flags & BLOCK_FLAG_HIDDEN);
+		if (flags & BLOCK_FLAG_EXISTS && visible) {
+			if (list->count < list->capacity)
+				list->instances[list->count++] = voxel_pack(tree->voxel);
+			else
+				list->dropped++;
+		}
+	} else {
+		for (uint8_t i = 0; i < 8; i++)
+			voxel_emit_node(list, tree->children[(i&4) >> 2][(i&2) >> 1][i&1], in_range || starts_range);
+	}
+
+	if (starts_range && list->count > first && list->range_count < list->range_capacity) {
+		voxel_range_t *range = list->ranges + list->range_count++;
+		range->first = first;
+		range->count = list->count - first;
+
+		/* bounds come from the instances as merged boxes can reach past
+		 * the subtree
+		 */
+		for (uint8_t axis = 0; axis < 3; axis++) {
+			range->min[axis] = 0xff;
+			range->max[axis] = 0;
+		}
+
+		for (size_t i = first; i < list->count; i++) {
+			voxel_packed_t packed = list->instances[i];
+			for (uint8_t axis = 0; axis < 3; axis++) {
+				uint32_t lo = packed >> (7 * axis) & 0x7f;
+				uint32_t hi = lo + (1 << (packed >> (21 + 3 * axis) & 7));
+				range->min[axis] = lo < range->min[axis] ? lo : range->min[axis];
+				range->max[axis] = hi > range->max[axis] ? hi : range->max[axis];
 			}
+		}
+	}
+}
 
-			uint8_t scale_a_x = get_scale_x(child_a->voxel->scale);
-			uint8_t scale_b_x = get_scale_x(child_b->voxel->scale);
+void voxel_emit(voxel_draw_list_t *list, voct_node_t const *tree) {
+	voxel_emit_node(list, tree, false);
+}
 
-			uint8_t scale_a_y = get_scale_y(child_a->voxel->scale);
-			uint8_t scale_b_y = get_scale_y(child_b->voxel->scale);
+void voxel_count_faces(voct_node_t const *tree, size_t counts[VOXEL_FACE_COUNT]) {
+	if (!tree)
+		return;
 
-			if (scale_a_x == scale_b_x && scale_a_y == scale_b_y) {
-				uint8_t scale_a_z = get_scale_z(child_a->voxel->scale);
-				uint8_t scale_b_z = get_scale_z(child_b->voxel->scale);
-				uint8_t scale_z = scale_a_z + scale_b_z;
+	if (!tree->is_leaf) {
+		for (uint8_t i = 0; i < 8; i++)
+			voxel_count_faces(tree->children[(i&4) >> 2][(i&2) >> 1][i&1], counts);
+		return;
+	}
 
-				child_a->voxel->scale = scale_a_x << 24 | scale_a_y << 16 | scale_a_z << 8 | BLOCK_FLAG_EXISTS;
-				child_b->voxel->scale = 0;
+	block_flags_t flags = tree->voxel->scale & 0xff;
+	if (!(flags & BLOCK_FLAG_EXISTS))
+		return;
+
+	for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++)
+		counts[face] += !!(flags & BLOCK_FLAG_FACE(face));
+}
 
-				puts("here");
+/* rows of a mesh plane are VOXEL_OCC_SIZE bits laid out like occupancy
+ * columns, bit i of the row in word i / 64
+ */
+#define VOXEL_ROW_WORDS (VOXEL_OCC_SIZE / 64)
+
+static uint32_t voxel_row_first(uint64_t const *row) {
+	for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++)
+		if (row[w])
+			return w * 64 + __builtin_ctzll(row[w]);
+
+	return VOXEL_OCC_SIZE;
+}
+
+/* returns the end of the run of set bits starting at lo */
+static uint32_t voxel_row_run(uint64_t const *row, uint32_t lo) {
+	uint32_t hi = lo;
+
+	while (hi < VOXEL_OCC_SIZE) {
+		uint32_t shift = hi & 63;
+		uint64_t rest = ~(row[hi >> 6] >> shift);
+		uint32_t ones = rest ? __builtin_ctzll(rest) : 64;
+
+		hi += ones;
+		if (shift + ones < 64)
+			break;
+	}
+
+	return hi;
+}
+
+static void voxel_row_span(uint64_t *span, uint32_t lo, uint32_t hi) {
+	for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++) {
+		uint32_t begin = lo > w * 64 ? lo - w * 64 : 0;
+		uint32_t end = hi < w * 64 + 64 ? (hi > w * 64 ? hi - w * 64 : 0) : 64;
+
+		span[w] = 0;
+		if (begin < end)
+			span[w] = (end - begin == 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << (end - begin)) - 1)) << begin;
+	}
+}
+
+/* the face of every solid voxel along axis whose neighbour on side is empty,
+ * as plane rows: slice x then row y for x faces, slice y then row x for y
+ * faces, both with bits along z; slice z then row x with bits along y for z
+ * faces
+ */
+static void voxel_mesh_faces(uint64_t *plane, uint64_t const *occ, uint8_t axis, uint8_t side) {
+	uint32_t const n = VOXEL_OCC_SIZE;
+
+	if (axis == 2)
+		memset(plane, 0, sizeof(*plane) * VOXEL_OCC_WORDS);
+
+	for (uint32_t x = 0; x < n; x++) {
+		for (uint32_t y = 0; y < n; y++) {
+			uint64_t const *col = occ + voxel_occ_index(x, y, 0);
+			uint64_t const *next = NULL;
+
+			if (axis == 0 && (side ? x + 1 < n : x > 0))
+				next = occ + voxel_occ_index(side ? x + 1 : x - 1, y, 0);
+			if (axis == 1 && (side ? y + 1 < n : y > 0))
+				next = occ + voxel_occ_index(x, side ? y + 1 : y - 1, 0);
+
+			if (axis != 2) {
+				uint64_t *row = plane + (axis == 0 ? voxel_occ_index(x, y, 0) : voxel_occ_index(y, x, 0));
+				for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++)
+					row[w] = col[w] & ~(next ? next[w] : 0);
+				continue;
+			}
+
+			/* along z the neighbour is the next bit of the same column */
+			for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++) {
+				uint64_t shifted;
+				if (side)
+					shifted = col[w] >> 1 | (w + 1 < VOXEL_ROW_WORDS ? col[w + 1] << 63 : 0);
+				else
+					shifted = col[w] << 1 | (w ? col[w - 1] >> 63 : 0);
+
+				uint64_t faces = col[w] & ~shifted;
+				while (faces) {
+					uint32_t z = w * 64 + __builtin_ctzll(faces);
+					plane[voxel_occ_index(z, x, y)] |= (uint64_t) 1 << (y & 63);
+					faces &= faces - 1;
+				}
+			}
+		}
+	}
+}
+
+/* merges each plane row's runs with the identical runs in the rows after it */
+static void voxel_mesh_plane(voxel_mesh_t *mesh, uint64_t *plane, uint8_t face) {
+	uint32_t const n = VOXEL_OCC_SIZE;
+	uint8_t axis = face >> 1;
+
+	for (uint32_t slice = 0; slice < n; slice++) {
+		for (uint32_t r = 0; r < n; r++) {
+			uint64_t *row = plane + voxel_occ_index(slice, r, 0);
+			uint32_t lo;
+
+			while ((lo = voxel_row_first(row)) < n) {
+				uint32_t hi = voxel_row_run(row, lo);
+				uint64_t span[VOXEL_ROW_WORDS];
+				voxel_row_span(span, lo, hi);
+
+				uint32_t end = r + 1;
+				for (; end < n; end++) {
+					uint64_t *other = plane + voxel_occ_index(slice, end, 0);
+					bool covered = true;
+					for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++)
+						covered &= (other[w] & span[w]) == span[w];
+					if (!covered)
+						break;
+					for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++)
+						other[w] &= ~span[w];
+				}
+
+				for (uint32_t w = 0; w < VOXEL_ROW_WORDS; w++)
+					row[w] &= ~span[w];
+
+				if (mesh->count == mesh->capacity) {
+					mesh->dropped++;
+					continue;
+				}
+
+				/* bits run along z for x and y faces and along y for z faces,
+				 * rows along the remaining axis
+				 */
+				uint8_t bits = hi - lo, rows = end - r;
+				voxel_quad_t *quad = mesh->quads + mesh->count++;
+				if (axis == 0)
+					*quad = (voxel_quad_t){ slice, r, lo, face, rows, bits };
+				else if (axis == 1)
+					*quad = (voxel_quad_t){ r, slice, lo, face, bits, rows };
+				else
+					*quad = (voxel_quad_t){ r, lo, slice, face, rows, bits };
 			}
 		}
 	}
 }
 
+void voxel_mesh(voxel_mesh_t *mesh, uint64_t const *occ) {
+	uint64_t *plane = malloc(sizeof(*plane) * VOXEL_OCC_WORDS);
+	if (!plane) {
+		fprintf(stderr, "error: out of memory meshing chunk\n");
+		exit(1);
+	}
+
+	for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++) {
+		mesh->face_first[face] = mesh->count;
+		voxel_mesh_faces(plane, occ, face >> 1, face & 1);
+		voxel_mesh_plane(mesh, plane, face);
+		mesh->face_count[face] = mesh->count - mesh->face_first[face];
+	}
+
+	free(plane);
+}
+
 void dump_tree(voct_node_t *tree) {
 
 	if (!tree) {
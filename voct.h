@@ -1,3 +1,6 @@
+#ifndef VOCT_H__
+#define VOCT_H__
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -8,11 +11,38 @@ typedef enum block_t {
 } block_t;
 
 
+/* faces are numbered axis * 2 + side, side 0 facing down the axis */
+#define VOXEL_FACE_COUNT 6
+
 typedef enum block_flags_t {
 	BLOCK_FLAG_EXISTS=(1 << 0),
+	/* no face is open */
 	BLOCK_FLAG_HIDDEN=(1 << 1),
+	/* one bit per open face from BLOCK_FLAG_FACE(0), set by voxel_set_visible */
+	BLOCK_FLAG_FACES=(0x3f << 2),
 } block_flags_t;
 
+#define BLOCK_FLAG_FACE(face) (1 << (2 + (face)))
+
+/* packed occupancy bitmap of a VOXEL_OCC_SIZE^3 chunk, one bit per voxel.
+ * z runs along the bits of consecutive words, then y, then x
+ */
+#define VOXEL_OCC_DEPTH 7
+#define VOXEL_OCC_SIZE (1 << VOXEL_OCC_DEPTH)
+#define VOXEL_OCC_WORDS (VOXEL_OCC_SIZE * VOXEL_OCC_SIZE * VOXEL_OCC_SIZE / 64)
+
+static inline size_t voxel_occ_index(uint32_t x, uint32_t y, uint32_t z) {
+	return ((size_t) x * VOXEL_OCC_SIZE + y) * (VOXEL_OCC_SIZE / 64) + (z >> 6);
+}
+
+static inline bool voxel_occ_get(uint64_t const *occ, uint32_t x, uint32_t y, uint32_t z) {
+	return occ[voxel_occ_index(x, y, z)] >> (z & 63) & 1;
+}
+
+static inline void voxel_occ_set(uint64_t *occ, uint32_t x, uint32_t y, uint32_t z) {
+	occ[voxel_occ_index(x, y, z)] |= (uint64_t) 1 << (z & 63);
+}
+
 typedef struct voxel_t {
 	int32_t x;
 	int32_t y;
@@ -26,6 +56,20 @@ typedef struct voxel_t {
 	uint32_t scale;
 } voxel_t;
 
+/* voxel_t packed into one word for upload as an instance: chunk local x, y
+ * and z in 7 bits each from bit 0, a 3 bit scale exponent per axis from bit
+ * 21, and the exists and hidden flags in bits 30 and 31. vs_src decodes the
+ * same layout and adds the chunk origin
+ */
+typedef uint32_t voxel_packed_t;
+
+static inline voxel_packed_t voxel_pack(voxel_t const *voxel) {
+	uint32_t scale = voxel->scale;
+	return (voxel->x & 0x7f) | (voxel->y & 0x7f) << 7 | (voxel->z & 0x7f) << 14 |
+		(scale >> 24 & 7) << 21 | (scale >> 16 & 7) << 24 | (scale >> 8 & 7) << 27 |
+		(scale & (BLOCK_FLAG_EXISTS | BLOCK_FLAG_HIDDEN)) << 30;
+}
+
 typedef struct voct_node_t {
 	/* discriminator */
 	bool is_leaf;
@@ -44,22 +88,178 @@ typedef struct voct_node_t {
 	};
 } voct_node_t;
 
-/* fixed sized ring buffer that keeps track of generated
- * voxels. every time a new voxel is generated it's pushed to the ring buffer
- * if there's something already there it'll go update it in the voxel tree
- * to be no longer there
+/* per chunk node arena. nodes are carved out of slabs of VOCT_POOL_SLAB and
+ * released nodes go on a freelist for reuse; nothing goes back to the system
+ * until the whole pool is freed along with its chunk
  */
-#define VOXEL_CACHE_SIZE (128 * 128 * 128)
+#define VOCT_POOL_SLAB 4096
+typedef struct voct_slab_t {
+	struct voct_slab_t *next;
+	voct_node_t nodes[VOCT_POOL_SLAB];
+} voct_slab_t;
+
+typedef struct voct_pool_t {
+	voct_slab_t *slabs;
+	/* nodes handed out from the newest slab */
+	size_t slab_used;
+	/* chained through children[0][0][0] */
+	voct_node_t *free_list;
+
+	size_t allocs;
+	size_t frees;
+	size_t live;
+	size_t peak;
+	size_t slab_count;
+} voct_pool_t;
+
+void voct_pool_new(voct_pool_t *);
+void voct_pool_free(voct_pool_t *);
+voct_node_t *voct_pool_alloc(voct_pool_t *);
+void voct_pool_release(voct_pool_t *, voct_node_t *);
+void voct_pool_print(voct_pool_t const *);
+
+/* the leaf voxels of a chunk, laid out for upload as instances. slots live
+ * in pages of VOXEL_PAGE_SIZE allocated as the chunk fills, so a voxel never
+ * moves once handed out and is never taken back while its leaf lives.
+ * released slots are kept for reuse
+ */
+#define VOXEL_PAGE_SIZE 4096
 typedef struct voxel_cache_t {
-	voxel_t *ptr;
-	size_t ring_index;
+	voxel_t **pages;
+	size_t page_count;
+	size_t page_capacity;
+
+	/* slots handed out at least once, in order across the pages */
+	size_t slot_count;
+
+	voxel_t **free_slots;
+	size_t free_count;
+	size_t free_capacity;
+
+	size_t live;
+	size_t peak;
+
+	/* every node of the chunk's tree, bar the root, lives here */
+	voct_pool_t pool;
 } voxel_cache_t;
 
+static inline voxel_t *voxel_cache_slot(voxel_cache_t const *cache, size_t index) {
+	return cache->pages[index / VOXEL_PAGE_SIZE] + index % VOXEL_PAGE_SIZE;
+}
+
 void voxel_cache_new(voxel_cache_t *);
-voct_node_t *voxel_new(voxel_cache_t *cache, voct_node_t *root, uint32_t x, uint32_t y, uint32_t z, uint8_t depth);
-void voxel_set(voxel_cache_t *cache, voct_node_t *root, voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z);
+/* frees every voxel and node allocated from the cache */
+void voxel_cache_free(voxel_cache_t *);
+/* bytes held by the voxel pages, free list and node pool */
+size_t voxel_cache_bytes(voxel_cache_t const *);
+void voxel_cache_print(voxel_cache_t const *);
+/* moves every voxel and node of other into self without copying, so trees
+ * built from separate caches, one per thread, can become one chunk. other
+ * is left empty
+ */
+void voxel_cache_adopt(voxel_cache_t *self, voxel_cache_t *other);
+voct_node_t *voxel_new(voxel_cache_t *cache, uint32_t x, uint32_t y, uint32_t z, uint8_t depth);
+voct_node_t *voct_node_new(voxel_cache_t *cache, uint8_t depth);
+void voxel_set(voxel_cache_t *cache, voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z);
+bool voxel_collapse(voxel_cache_t *cache, voct_node_t *tree, uint32_t x, uint32_t y, uint32_t z);
+
+/* returns the voxel of the leaf covering x, y, z, or NULL if there is none
+ * or the walk reaches max_depth first
+ */
+voxel_t *voxel_find(voct_node_t *tree, uint8_t max_depth, uint32_t x, uint32_t y, uint32_t z);
+
+/* builds a whole chunk from an occupancy bitmap bottom up, allocating only
+ * the nodes that survive merging. root must be empty, at least
+ * VOXEL_OCC_SIZE voxels a side, and hold the chunk at its origin
+ */
+void voxel_build(voxel_cache_t *cache, voct_node_t *root, uint64_t const *occ);
+
+/* a contiguous span of a draw list holding the leaves of one subtree. its
+ * instances cover [min, max) on each axis in chunk local voxels
+ */
+typedef struct voxel_range_t {
+	uint32_t first;
+	uint32_t count;
+	uint8_t min[3];
+	uint8_t max[3];
+} voxel_range_t;
+
+typedef struct voxel_draw_list_t {
+	voxel_packed_t *instances;
+	size_t count;
+	size_t capacity;
+	/* leaves that did not fit */
+	size_t dropped;
+
+	/* when set, only leaves with one of these BLOCK_FLAG_FACES bits are
+	 * emitted, otherwise every leaf that is not hidden
+	 */
+	block_flags_t faces;
+
+	/* optional. every subtree at range_depth, or leaf above it, that emits
+	 * anything gets a range
+	 */
+	voxel_range_t *ranges;
+	size_t range_count;
+	size_t range_capacity;
+	uint8_t range_depth;
+} voxel_draw_list_t;
+
+/* appends the visible leaves of tree, which sits at the chunk origin, in
+ * morton order so that neighbouring instances are neighbours in space
+ */
+void voxel_emit(voxel_draw_list_t *list, voct_node_t const *tree);
+
+/* adds to counts[face] the leaves of tree with that face open, which is
+ * how many instances emitting each face on its own takes
+ */
+void voxel_count_faces(voct_node_t const *tree, size_t counts[VOXEL_FACE_COUNT]);
+
+/* one quad from voxel_mesh: the given face of the voxel at x, y, z stretched
+ * over width voxels along axis (face / 2 + 1) % 3 and height voxels along
+ * axis (face / 2 + 2) % 3
+ */
+typedef struct voxel_quad_t {
+	uint8_t x, y, z;
+	uint8_t face;
+	uint8_t width, height;
+} voxel_quad_t;
+
+typedef struct voxel_mesh_t {
+	voxel_quad_t *quads;
+	size_t count;
+	size_t capacity;
+	/* quads that did not fit */
+	size_t dropped;
+
+	/* quads come out grouped by face */
+	size_t face_first[VOXEL_FACE_COUNT];
+	size_t face_count[VOXEL_FACE_COUNT];
+} voxel_mesh_t;
+
+/* meshes an occupancy bitmap straight into greedy quads, without a tree.
+ * faces are found a column at a time with shifts and and-nots, and merged
+ * into maximal rectangles a row of bits at a time, so the cost follows the
+ * number of quads rather than voxels. faces on the chunk edge count as open,
+ * as in voxel_set_visible
+ */
+void voxel_mesh(voxel_mesh_t *mesh, uint64_t const *occ);
 
 void dump_tree(voct_node_t *tree);
 
-void voxel_set_visible(voct_node_t *root, voct_node_t *tree);
-void voxel_greedy(voct_node_t *tree);
+/* sets the face bits of every leaf whose face is not entirely covered by
+ * solid neighbours, and hides leaves with none. neighbours are carried down
+ * the recursion, so a face against a leaf at least as large is an O(1) test
+ * and only faces against split neighbours walk that neighbour's facing side.
+ * faces on the edge of tree count as open
+ */
+void voxel_set_visible(voct_node_t *tree);
+/* merges runs of leaves with open faces into boxes along x, then y, then z.
+ * leaves merge when they are the same size and agree on every face the box
+ * keeps; the first leaf of a run becomes the box, with per axis power of two
+ * extents in its scale bytes, and the rest are hidden. runs once after
+ * voxel_set_visible, which resets the merge. returns the leaves absorbed
+ */
+size_t voxel_greedy(voct_node_t *tree);
+
+#endif